@@ -0,0 +1,93 @@
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include "simulator.h"
+#include "simulator_context.h"
+#include "program_loader.h"
+
+using namespace std;
+
+// Verbosity benchmark
+// Times run_simulation() on a looping load/store program with the
+// VerboseTrace instantiation (output discarded, log.txt still written)
+// and the QuietTrace instantiation, and reports host throughput.
+//
+//      make bench && ./bench_verbosity [instructions]
+
+// Load/ALU/store loop that never halts
+static void build_loop_program(ProgramImage &image)
+{
+    const InstructionWord loop[] = {
+        pack_instruction(0x0D, 1, 10),      // LD R1, 10
+        pack_instruction(0x0D, 3, 11),      // LD R3, 11
+        pack_instruction(0x01, 1, 0),       // ADD R1
+        pack_instruction(0x0E, 1, 0x20),    // ST R1, 0x20
+        pack_instruction(0x0D, 5, 0x20),    // LD R5, 0x20
+        pack_instruction(0x0D, 6, 0x30),    // LD R6, 0x30
+        pack_instruction(0x03, 5, 0),       // MUL R5
+        pack_instruction(0x0E, 5, 0x40),    // ST R5, 0x40
+        pack_instruction(0x0D, 7, 0x40),    // LD R7, 0x40
+        pack_instruction(0x08, 0, 0x01),    // JMP 0x01 (resumes at 0x02)
+    };
+    
+    image.length = sizeof(loop) / sizeof(loop[0]);
+    image.image_words = image.length;
+    for (int i = 0; i < 256; i++)
+    {
+        image.words[i] = 0;
+        image.text[i].valid = false;
+    }
+    for (size_t i = 0; i < image.length; i++)
+    {
+        image.words[i] = loop[i];
+        disassemble(loop[i], image.text[i].instruction, image.text[i].mnemonic);
+        image.text[i].valid = true;
+    }
+}
+
+// Run `instructions` instructions and return host instructions per second
+static double time_run(const ProgramImage &image, uint64_t instructions,
+                       bool use_cache, bool verbose)
+{
+    ostream discard(nullptr);
+    SimulatorContext *ctx = new SimulatorContext;
+    ctx->out = &discard;
+    ctx->program = &image;
+    ctx->detail_instructions = instructions;
+    ctx->max_cycles = UINT64_MAX;
+    
+    auto start = chrono::steady_clock::now();
+    SimulationResult result = run_simulation(*ctx, true, use_cache, verbose);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    delete ctx;
+    
+    return result.instructions / seconds;
+}
+
+int main(int argc, char* argv[])
+{
+    uint64_t instructions = 200000;
+    if (argc > 1)
+        instructions = strtoull(argv[1], nullptr, 0);
+    
+    ProgramImage *image = new ProgramImage;
+    build_loop_program(*image);
+    
+    printf("Verbosity benchmark: %llu instructions per run\n\n",
+           (unsigned long long)instructions);
+    printf("Configuration      | VerboseTrace (inst/s) | QuietTrace (inst/s) | Speedup\n");
+    printf("-------------------+-----------------------+---------------------+--------\n");
+    
+    for (int use_cache = 0; use_cache <= 1; use_cache++)
+    {
+        double verbose_rate = time_run(*image, instructions, use_cache != 0, true);
+        double quiet_rate = time_run(*image, instructions, use_cache != 0, false);
+        printf("%-18s | %21.0f | %19.0f | %6.1fx\n",
+               use_cache ? "Forwarding + Cache" : "Forwarding only",
+               verbose_rate, quiet_rate, quiet_rate / verbose_rate);
+    }
+    
+    delete image;
+    return 0;
+}
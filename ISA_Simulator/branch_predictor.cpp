@@ -0,0 +1,238 @@
+#include "branch_predictor.h"
+
+using namespace std;
+
+const int COUNTER_MAX = 3;              // 2-bit saturating counters
+const int COUNTER_TAKEN = 2;
+const int TAGE_COUNTER_MIN = -4;        // 3-bit signed counters
+const int TAGE_COUNTER_MAX = 3;
+const int TAGE_USEFUL_MAX = 3;
+const int TAGE_AGING_PERIOD = 256;      // Updates between usefulness halvings
+static const int tage_history[TAGE_TABLES] = { 4, 8, 16 };
+
+// Forget all training
+void branch_predictor_reset(BranchPredictorState &state)
+{
+    for (int i = 0; i < BTB_ENTRIES; i++)
+        state.btb[i].valid = false;
+    for (int i = 0; i < BPRED_COUNTERS; i++)
+        state.counters[i] = 1;          // Weakly not taken
+    state.history = 0;
+    for (int t = 0; t < TAGE_TABLES; t++)
+        for (int i = 0; i < TAGE_ENTRIES; i++)
+        {
+            state.tage[t][i].tag = 0;   // Never matches: tags have bit 8 set
+            state.tage[t][i].counter = 0;
+            state.tage[t][i].useful = 0;
+        }
+    state.tage_updates = 0;
+}
+
+// XOR-fold the low length bits of history into bits bits
+static uint32_t fold_history(uint32_t history, int length, int bits)
+{
+    if (length < 32)
+        history &= (1u << length) - 1;
+    uint32_t folded = 0;
+    for (; history != 0; history >>= bits)
+        folded ^= history & ((1u << bits) - 1);
+    return folded;
+}
+
+// Counter index of the bimodal (and TAGE base) or gshare table
+static int counter_index(BranchPredictorKind kind, uint8_t pc, uint32_t history)
+{
+    if (kind == BPRED_GSHARE)
+        return (pc ^ fold_history(history, BPRED_HISTORY_BITS, 8)) % BPRED_COUNTERS;
+    return pc % BPRED_COUNTERS;
+}
+
+// TAGE lookup: the longest-history table whose tag matches provides the
+// prediction; the next match (or the base counter) is the alternate
+struct TageLookup
+{
+    int index[TAGE_TABLES];
+    uint16_t tag[TAGE_TABLES];
+    int provider;           // Table index, -1 if no tag matched
+    bool provider_taken;
+    bool alt_taken;
+};
+
+static void tage_lookup(const BranchPredictorState &state, uint8_t pc, uint32_t history, TageLookup &look)
+{
+    look.provider = -1;
+    int alt = -1;
+    for (int t = 0; t < TAGE_TABLES; t++)
+    {
+        look.index[t] = (pc ^ fold_history(history, tage_history[t], 5)) % TAGE_ENTRIES;
+        look.tag[t] = 0x100 | ((pc ^ fold_history(history, tage_history[t], 8) ^
+                                (fold_history(history, tage_history[t], 7) << 1)) & 0xFF);
+        if (state.tage[t][look.index[t]].tag == look.tag[t])
+        {
+            alt = look.provider;
+            look.provider = t;
+        }
+    }
+
+    bool base_taken = state.counters[pc % BPRED_COUNTERS] >= COUNTER_TAKEN;
+    look.provider_taken = look.provider >= 0 ? state.tage[look.provider][look.index[look.provider]].counter >= 0
+                                             : base_taken;
+    look.alt_taken = alt >= 0 ? state.tage[alt][look.index[alt]].counter >= 0 : base_taken;
+}
+
+// Direction of a conditional branch that hit in the BTB
+static bool predict_direction(const BranchPredictorState &state, BranchPredictorKind kind,
+                              uint8_t pc, uint8_t target, uint32_t history)
+{
+    switch (kind)
+    {
+        case BPRED_STATIC:
+            return target <= pc;
+        case BPRED_BIMODAL:
+        case BPRED_GSHARE:
+            return state.counters[counter_index(kind, pc, history)] >= COUNTER_TAKEN;
+        case BPRED_TAGE:
+        {
+            TageLookup look;
+            tage_lookup(state, pc, history, look);
+            return look.provider_taken;
+        }
+        default:
+            return false;
+    }
+}
+
+// Move a 2-bit counter towards the outcome
+static void train_counter(uint8_t &counter, bool taken)
+{
+    if (taken && counter < COUNTER_MAX)
+        counter++;
+    else if (!taken && counter > 0)
+        counter--;
+}
+
+// Train the provider (or base), adjust usefulness, and on a mispredict
+// allocate an entry in a longer-history table
+static void tage_update(BranchPredictorState &state, uint8_t pc, bool taken, uint32_t history)
+{
+    TageLookup look;
+    tage_lookup(state, pc, history, look);
+
+    if (look.provider >= 0)
+    {
+        TageEntry &entry = state.tage[look.provider][look.index[look.provider]];
+        if (look.provider_taken != look.alt_taken)
+        {
+            if (look.provider_taken == taken && entry.useful < TAGE_USEFUL_MAX)
+                entry.useful++;
+            else if (look.provider_taken != taken && entry.useful > 0)
+                entry.useful--;
+        }
+        if (taken && entry.counter < TAGE_COUNTER_MAX)
+            entry.counter++;
+        else if (!taken && entry.counter > TAGE_COUNTER_MIN)
+            entry.counter--;
+    }
+    else
+    {
+        train_counter(state.counters[pc % BPRED_COUNTERS], taken);
+    }
+
+    if (look.provider_taken != taken)
+    {
+        bool allocated = false;
+        for (int t = look.provider + 1; t < TAGE_TABLES && !allocated; t++)
+        {
+            TageEntry &entry = state.tage[t][look.index[t]];
+            if (entry.useful == 0)
+            {
+                entry.tag = look.tag[t];
+                entry.counter = taken ? 0 : -1;
+                allocated = true;
+            }
+        }
+        for (int t = look.provider + 1; t < TAGE_TABLES && !allocated; t++)
+        {
+            TageEntry &entry = state.tage[t][look.index[t]];
+            if (entry.useful > 0)
+                entry.useful--;
+        }
+    }
+
+    if (++state.tage_updates % TAGE_AGING_PERIOD == 0)
+        for (int t = 0; t < TAGE_TABLES; t++)
+            for (int i = 0; i < TAGE_ENTRIES; i++)
+                state.tage[t][i].useful >>= 1;
+}
+
+// Next fetch PC after the instruction at pc
+BranchPrediction branch_predict(const BranchPredictorState &state, BranchPredictorKind kind, uint8_t pc)
+{
+    BranchPrediction prediction = { (uint8_t)(pc + 1), false, state.history };
+    if (kind == BPRED_NONE)
+        return prediction;
+
+    const BTBEntry &entry = state.btb[pc % BTB_ENTRIES];
+    if (!entry.valid || entry.pc != pc)
+        return prediction;
+
+    prediction.taken = !entry.conditional || predict_direction(state, kind, pc, entry.target, state.history);
+    if (prediction.taken)
+        prediction.next_pc = entry.target;
+    return prediction;
+}
+
+// Train on a resolved JMP or conditional branch
+void branch_update(BranchPredictorState &state, BranchPredictorKind kind, uint8_t pc,
+                   bool conditional, bool taken, uint8_t target, const BranchPrediction &prediction)
+{
+    if (kind == BPRED_NONE)
+        return;
+
+    if (conditional)
+    {
+        if (kind == BPRED_BIMODAL || kind == BPRED_GSHARE)
+            train_counter(state.counters[counter_index(kind, pc, prediction.history)], taken);
+        else if (kind == BPRED_TAGE)
+            tage_update(state, pc, taken, prediction.history);
+        state.history = (state.history << 1) | (taken ? 1 : 0);
+    }
+
+    // Allocate on taken; a not-taken branch keeps an existing entry
+    if (taken)
+    {
+        BTBEntry &entry = state.btb[pc % BTB_ENTRIES];
+        entry.valid = true;
+        entry.pc = pc;
+        entry.target = target;
+        entry.conditional = conditional;
+    }
+}
+
+// Drop a stale BTB entry for pc
+void branch_forget(BranchPredictorState &state, uint8_t pc)
+{
+    BTBEntry &entry = state.btb[pc % BTB_ENTRIES];
+    if (entry.valid && entry.pc == pc)
+        entry.valid = false;
+}
+
+static const char *const branch_predictor_names[] = { "none", "static", "bimodal", "gshare", "tage" };
+
+const char *branch_predictor_name(BranchPredictorKind kind)
+{
+    return branch_predictor_names[kind];
+}
+
+bool parse_branch_predictor(const string &name, BranchPredictorKind &kind)
+{
+    for (int i = BPRED_NONE; i <= BPRED_TAGE; i++)
+    {
+        if (name == branch_predictor_names[i])
+        {
+            kind = (BranchPredictorKind)i;
+            return true;
+        }
+    }
+    return false;
+}
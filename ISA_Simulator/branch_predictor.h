@@ -0,0 +1,90 @@
+#ifndef BRANCH_PREDICTOR_H
+#define BRANCH_PREDICTOR_H
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/*
+     Branch prediction unit
+     Fetch calls branch_predict() for the PC to fetch next. The BTB
+     (direct mapped, tagged with the full 8-bit PC) holds the target of
+     every JMP and taken branch seen so far; on a BTB hit a JMP is taken
+     and a conditional branch asks the direction predictor. EX resolves
+     the instruction and calls branch_update() with the outcome. A next
+     PC that differs from the predicted one flushes the pipeline.
+     BPRED_NONE skips the BTB: fetch always continues at PC + 1, so
+     every taken JMP or branch flushes (the original behavior).
+     Global history is updated when a branch resolves, not speculatively
+     at fetch.
+*/
+
+enum BranchPredictorKind
+{
+    BPRED_NONE,
+    BPRED_STATIC,       // Backward taken, forward not taken (BTFN)
+    BPRED_BIMODAL,      // PC-indexed 2-bit counters
+    BPRED_GSHARE,       // 2-bit counters indexed by PC xor global history
+    BPRED_TAGE          // Bimodal base plus tagged tables of geometric history lengths
+};
+
+#define BRANCH_PREDICTOR BPRED_NONE
+#define BTB_ENTRIES 16
+#define BPRED_COUNTERS 64           // Bimodal/gshare/TAGE base counters
+#define BPRED_HISTORY_BITS 6        // gshare history length
+#define TAGE_TABLES 3               // History lengths 4, 8, 16
+#define TAGE_ENTRIES 32             // Entries per tagged table
+
+struct BTBEntry
+{
+    bool valid;
+    uint8_t pc;
+    uint8_t target;         // Next PC when taken (JMP: target + 1)
+    bool conditional;
+};
+
+// One tagged TAGE entry: 3-bit signed counter, 2-bit usefulness
+struct TageEntry
+{
+    uint16_t tag;           // Bit 8 set once allocated
+    int8_t counter;         // >= 0 predicts taken
+    uint8_t useful;
+};
+
+struct BranchPredictorState
+{
+    BTBEntry btb[BTB_ENTRIES];
+    uint8_t counters[BPRED_COUNTERS];   // 2-bit, >= 2 predicts taken
+    uint32_t history;                   // Resolved conditional outcomes, newest in bit 0
+    TageEntry tage[TAGE_TABLES][TAGE_ENTRIES];
+    uint32_t tage_updates;              // Usefulness ages every 256 updates
+};
+
+// What fetch predicted for one instruction; travels with it to EX
+struct BranchPrediction
+{
+    uint8_t next_pc;        // PC fetched after it
+    bool taken;
+    uint32_t history;       // Global history the direction was predicted with
+};
+
+// Forget all training
+void branch_predictor_reset(BranchPredictorState &state);
+
+// Next fetch PC after the instruction at pc
+BranchPrediction branch_predict(const BranchPredictorState &state, BranchPredictorKind kind, uint8_t pc);
+
+// Train on a resolved JMP (conditional false) or conditional branch.
+// target is the next PC when taken.
+void branch_update(BranchPredictorState &state, BranchPredictorKind kind, uint8_t pc,
+                   bool conditional, bool taken, uint8_t target, const BranchPrediction &prediction);
+
+// Drop a stale BTB entry for pc (the word there is no longer a branch)
+void branch_forget(BranchPredictorState &state, uint8_t pc);
+
+// Predictor names: none, static, bimodal, gshare, tage
+const char *branch_predictor_name(BranchPredictorKind kind);
+bool parse_branch_predictor(const string &name, BranchPredictorKind &kind);
+
+#endif // BRANCH_PREDICTOR_H
@@ -1,183 +1,1391 @@
 #include "cache.h"
+#include "simulator_context.h"
 #include "data_memory.h"
 #include "log_handler.h"
+#include <cstdio>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
 
 using namespace std;
 
-// Cache array
-CacheLine cache[CACHE_LINES];
-
-// Cache performance counters
-uint64_t cache_hits = 0;
-uint64_t cache_misses = 0;
-uint64_t cache_stall_cycles = 0;
+const uint8_t RRPV_MAX = 3;          // 2-bit RRPV: 3 = distant re-reference
+const uint8_t RRPV_LONG = 2;         // SRRIP insertion value
+const uint32_t BRRIP_LONG_ODDS = 32; // BRRIP inserts at RRPV_LONG once in this many fills
 
 // Initialize cache - all lines invalid
-void initialize_cache()
+void initialize_cache(SimulatorContext &ctx)
 {
-    for (int i = 0; i < CACHE_LINES; i++)
+    cache_configure(ctx.cache, ctx.cache_config);
+    for (int i = 0; i < ctx.hierarchy_config.lower_levels; i++)
+    {
+        cache_configure(ctx.lower_cache[i], ctx.hierarchy_config.level[i].cache);
+        CacheLevelStats &stats = ctx.lower_cache_stats[i];
+        stats.hits = 0;
+        stats.misses = 0;
+        stats.writebacks = 0;
+        stats.back_invalidations = 0;
+    }
+    
+    if (ctx.icache_config.lines > 0)
+        cache_configure(ctx.icache, ctx.icache_config);
+    ctx.icache_hits = 0;
+    ctx.icache_misses = 0;
+    ctx.icache_stall_cycles = 0;
+    
+    ctx.cache_hits = 0;
+    ctx.cache_misses = 0;
+    ctx.cache_stall_cycles = 0;
+    ctx.cache_writebacks = 0;
+    ctx.memory_writes = 0;
+    ctx.write_buffer_stalls = 0;
+    ctx.write_buffer_coalesced = 0;
+    ctx.mshr_merges = 0;
+    ctx.mshr_full_stalls = 0;
+    ctx.mshr_dependency_stalls = 0;
+    ctx.mshr_peak = 0;
+    ctx.miss_latency_cycles = 0;
+    ctx.mshr_busy_cycles = 0;
+    ctx.mshr_busy_until = 0;
+    prefetcher_reset(ctx.prefetcher);
+    ctx.prefetch_issued = 0;
+    ctx.prefetch_useful = 0;
+    ctx.prefetch_late = 0;
+    
+    if (ctx.cache_config.victim_lines > 0)
     {
-        cache[i].valid = false;
-        cache[i].tag = 0;
-        cache[i].data = 0;
+        CacheConfig victim = ctx.cache_config;
+        victim.lines = victim.ways = victim.victim_lines;
+        victim.replacement = REPLACE_LRU;
+        cache_configure(ctx.victim_cache, victim);
     }
+    ctx.victim_hits = 0;
+    ctx.victim_misses = 0;
+    
+    CacheConfig shadow = ctx.cache_config;
+    shadow.ways = shadow.lines;
+    shadow.replacement = REPLACE_LRU;
+    cache_configure(ctx.shadow_cache, shadow);
+    for (int i = 0; i < 8; i++)
+        ctx.touched_blocks[i] = 0;
+    ctx.compulsory_misses = 0;
+    ctx.capacity_misses = 0;
+    ctx.conflict_misses = 0;
+    for (int i = 0; i < MAX_CACHE_LINES; i++)
+    {
+        ctx.set_accesses[i] = 0;
+        ctx.set_misses[i] = 0;
+        ctx.set_conflicts[i] = 0;
+    }
+    
+    *ctx.out << "Cache initialized: " << describe_cache_config(ctx.cache_config) << endl;
+    for (int i = 0; i < ctx.hierarchy_config.lower_levels; i++)
+        *ctx.out << "  L" << i + 2 << ": " << describe_cache_level(ctx.hierarchy_config.level[i]) << endl;
+    if (ctx.icache_config.lines > 0)
+        *ctx.out << "I-cache initialized: " << describe_cache_config(ctx.icache_config) << endl;
+}
+
+// log2 of a power of two
+static int log2_int(int value)
+{
+    int bits = 0;
+    while ((1 << bits) < value)
+        bits++;
+    return bits;
+}
+
+// Set geometry from config and invalidate every line
+void cache_configure(Cache &cache, const CacheConfig &config)
+{
+    cache.config = config;
+    cache.sets = config.lines / config.ways;
+    cache.offset_bits = log2_int(config.block_size);
+    cache.index_bits = log2_int(cache.sets);
     
-    cache_hits = 0;
-    cache_misses = 0;
-    cache_stall_cycles = 0;
+    for (int i = 0; i < config.lines; i++)
+    {
+        cache.line[i].valid = false;
+        cache.line[i].dirty = false;
+        cache.line[i].tag = 0;
+        cache.line[i].rrpv = RRPV_MAX;
+        cache.line[i].prefetched = false;
+        cache.line[i].prefetch_ready = 0;
+        cache.line[i].last_use = 0;
+        cache.plru[i] = 0;
+    }
+    for (int i = 0; i < config.lines * config.block_size; i++)
+        cache.data[i] = 0;
     
-    cout << "Cache initialized: " << CACHE_LINES << " lines, direct-mapped" << endl;
+    cache.clock = 0;
+    cache.random_state = 0x9E3779B9u;
+    cache.write_buffer.count = 0;
+    cache.mshr.count = 0;
 }
 
 // Get index bits from address
-uint8_t get_cache_index(uint8_t address)
+uint8_t get_cache_index(SimulatorContext &ctx, uint8_t address)
 {
-    // Index = lower INDEX_BITS of address
-    return address & ((1 << INDEX_BITS) - 1);
+    return cache_set_index(ctx.cache, address);
 }
 
 // Get tag bits from address
-uint8_t get_cache_tag(uint8_t address)
+uint8_t get_cache_tag(SimulatorContext &ctx, uint8_t address)
 {
-    // Tag = upper TAG_BITS of address
-    return address >> INDEX_BITS;
+    return cache_tag(ctx.cache, address);
 }
 
-// Cache read function
-uint8_t cache_read(uint8_t address, bool &hit_flag, int &stall_cycles)
+// Set index = bits above the block offset
+uint8_t cache_set_index(const Cache &cache, uint8_t address)
+{
+    return (address >> cache.offset_bits) & ((1 << cache.index_bits) - 1);
+}
+
+// Tag = remaining upper bits of address
+uint8_t cache_tag(const Cache &cache, uint8_t address)
+{
+    return address >> (cache.offset_bits + cache.index_bits);
+}
+
+// Byte within the block
+uint8_t cache_block_offset(const Cache &cache, uint8_t address)
+{
+    return address & ((1 << cache.offset_bits) - 1);
+}
+
+// Check that a configuration can be simulated
+bool is_valid_cache_config(const CacheConfig &config)
+{
+    if (config.lines < 1 || config.lines > MAX_CACHE_LINES)
+        return false;
+    if ((config.lines & (config.lines - 1)) != 0)
+        return false;  // Index bits require a power of two
+    if (config.ways < 1 || config.ways > config.lines || (config.ways & (config.ways - 1)) != 0)
+        return false;
+    if (config.block_size < 1 || (config.block_size & (config.block_size - 1)) != 0)
+        return false;
+    if (config.lines * config.block_size > MAX_CACHE_BYTES)
+        return false;
+    if (config.replacement < REPLACE_LRU || config.replacement > REPLACE_BRRIP)
+        return false;
+    if (config.write_policy != WRITE_THROUGH && config.write_policy != WRITE_BACK)
+        return false;
+    if (config.write_buffer < 0 || config.write_buffer > MAX_WRITE_BUFFER)
+        return false;
+    if (config.mshrs < 0 || config.mshrs > MAX_MSHRS)
+        return false;
+    if (config.prefetcher < PREFETCH_NONE || config.prefetcher > PREFETCH_STREAM)
+        return false;
+    if (config.victim_lines < 0 || config.victim_lines > MAX_VICTIM_LINES ||
+        config.victim_lines * config.block_size > MAX_CACHE_BYTES || config.victim_swap_cycles < 1)
+        return false;
+    return config.hit_cycles >= 1 && config.miss_penalty >= 1;
+}
+
+// "8 lines, direct-mapped" / "8 lines, 2-way (4 sets), 4-byte blocks, LRU"
+string describe_cache_config(const CacheConfig &config)
+{
+    string text = to_string(config.lines) + " lines, ";
+    if (config.ways == 1)
+        text += "direct-mapped";
+    else if (config.ways == config.lines)
+        text += "fully associative";
+    else
+        text += to_string(config.ways) + "-way (" + to_string(config.lines / config.ways) + " sets)";
+    
+    if (config.block_size > 1)
+        text += ", " + to_string(config.block_size) + "-byte blocks";
+    
+    // Replacement only matters with a choice of way
+    if (config.ways > 1)
+    {
+        string policy = replacement_policy_name(config.replacement);
+        for (size_t i = 0; i < policy.size(); i++)
+            policy[i] = toupper((unsigned char)policy[i]);
+        text += ", " + policy;
+    }
+    
+    if (config.write_policy == WRITE_BACK)
+        text += ", write-back";
+    if (config.write_buffer > 0)
+        text += ", " + to_string(config.write_buffer) + "-entry write buffer";
+    if (config.mshrs > 0)
+        text += ", " + to_string(config.mshrs) + (config.mshrs == 1 ? " MSHR" : " MSHRs");
+    if (config.prefetcher != PREFETCH_NONE)
+        text += string(", ") + prefetch_policy_name(config.prefetcher) + " prefetcher";
+    if (config.victim_lines > 0)
+        text += ", " + to_string(config.victim_lines) + "-line victim cache (" +
+                to_string(config.victim_swap_cycles) + "-cycle swap)";
+    return text;
+}
+
+static const char *const replacement_names[] = { "lru", "plru", "random", "srrip", "brrip" };
+
+// Policy names: lru, plru, random, srrip, brrip
+const char *replacement_policy_name(ReplacementPolicy policy)
+{
+    return replacement_names[policy];
+}
+
+bool parse_replacement_policy(const string &name, ReplacementPolicy &policy)
+{
+    for (int i = REPLACE_LRU; i <= REPLACE_BRRIP; i++)
+    {
+        if (name == replacement_names[i])
+        {
+            policy = (ReplacementPolicy)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static const char *const write_policy_names[] = { "wt", "wb" };
+
+// Write policy names: wt, wb
+const char *write_policy_name(WritePolicy policy)
 {
-    uint8_t index = get_cache_index(address);
-    uint8_t tag = get_cache_tag(address);
+    return write_policy_names[policy];
+}
+
+bool parse_write_policy(const string &name, WritePolicy &policy)
+{
+    for (int i = WRITE_THROUGH; i <= WRITE_BACK; i++)
+    {
+        if (name == write_policy_names[i])
+        {
+            policy = (WritePolicy)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Check lower levels against the L1 config and each other
+bool is_valid_cache_hierarchy(const CacheConfig &l1, const CacheHierarchyConfig &hierarchy)
+{
+    if (hierarchy.lower_levels < 0 || hierarchy.lower_levels > MAX_CACHE_LEVELS - 1)
+        return false;
     
-    // Check for cache hit
-    if (cache[index].valid && cache[index].tag == tag)
+    const CacheConfig *above = &l1;
+    for (int i = 0; i < hierarchy.lower_levels; i++)
+    {
+        const CacheLevelConfig &level = hierarchy.level[i];
+        if (!is_valid_cache_config(level.cache))
+            return false;
+        if (level.inclusion < INCLUSION_NINE || level.inclusion > INCLUSION_EXCLUSIVE)
+            return false;
+        if (level.cache.block_size < above->block_size)
+            return false;
+        if (level.inclusion == INCLUSION_EXCLUSIVE && level.cache.block_size != above->block_size)
+            return false;
+        above = &level.cache;
+    }
+    return true;
+}
+
+// "32 lines, 4-way (8 sets), LRU, inclusive, 3-cycle hit"
+string describe_cache_level(const CacheLevelConfig &level)
+{
+    // Write policy, buffer, MSHRs, prefetcher and victim cache belong to the L1
+    CacheConfig config = level.cache;
+    config.write_policy = WRITE_THROUGH;
+    config.write_buffer = 0;
+    config.mshrs = 0;
+    config.prefetcher = PREFETCH_NONE;
+    config.victim_lines = 0;
+    return describe_cache_config(config) + ", " + inclusion_policy_name(level.inclusion) + ", " +
+           to_string(level.cache.hit_cycles) + "-cycle hit";
+}
+
+static const char *const inclusion_names[] = { "nine", "inclusive", "exclusive" };
+
+// Inclusion names: nine, inclusive, exclusive
+const char *inclusion_policy_name(InclusionPolicy policy)
+{
+    return inclusion_names[policy];
+}
+
+bool parse_inclusion_policy(const string &name, InclusionPolicy &policy)
+{
+    for (int i = INCLUSION_NINE; i <= INCLUSION_EXCLUSIVE; i++)
+    {
+        if (name == inclusion_names[i])
+        {
+            policy = (InclusionPolicy)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// xorshift32 step
+static uint32_t next_random(Cache &cache)
+{
+    uint32_t x = cache.random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    cache.random_state = x;
+    return x;
+}
+
+// Point the tree-PLRU bits on the path to way away from it
+static void plru_touch(Cache &cache, int set, int way)
+{
+    int ways = cache.config.ways;
+    uint8_t *tree = &cache.plru[set * ways];
+    int node = way + ways - 1;      // Leaf position in the heap layout
+    while (node > 0)
+    {
+        int parent = (node - 1) / 2;
+        tree[parent] = (node == 2 * parent + 1) ? 1 : 0;  // 1 = victim on the right
+        node = parent;
+    }
+}
+
+// Follow the tree-PLRU bits to the pseudo-LRU way
+static int plru_victim(const Cache &cache, int set)
+{
+    int ways = cache.config.ways;
+    const uint8_t *tree = &cache.plru[set * ways];
+    int node = 0;
+    while (node < ways - 1)
+        node = 2 * node + 1 + tree[node];
+    return node - (ways - 1);
+}
+
+// Replacement update on a hit
+static void touch_line(Cache &cache, int set, int way)
+{
+    CacheLine &line = cache.line[set * cache.config.ways + way];
+    switch (cache.config.replacement)
+    {
+        case REPLACE_LRU:
+            line.last_use = ++cache.clock;
+            break;
+        case REPLACE_PLRU:
+            plru_touch(cache, set, way);
+            break;
+        case REPLACE_SRRIP:
+        case REPLACE_BRRIP:
+            line.rrpv = 0;     // Near-immediate re-reference
+            break;
+        case REPLACE_RANDOM:
+            break;
+    }
+}
+
+// Replacement update on a fill
+static void insert_line(Cache &cache, int set, int way)
+{
+    CacheLine &line = cache.line[set * cache.config.ways + way];
+    switch (cache.config.replacement)
+    {
+        case REPLACE_LRU:
+            line.last_use = ++cache.clock;
+            break;
+        case REPLACE_PLRU:
+            plru_touch(cache, set, way);
+            break;
+        case REPLACE_SRRIP:
+            line.rrpv = RRPV_LONG;
+            break;
+        case REPLACE_BRRIP:
+            line.rrpv = (next_random(cache) % BRRIP_LONG_ODDS == 0) ? RRPV_LONG : RRPV_MAX;
+            break;
+        case REPLACE_RANDOM:
+            break;
+    }
+}
+
+// Way to replace in set: an invalid line if any, else the policy's choice
+static int choose_victim(Cache &cache, int set)
+{
+    int ways = cache.config.ways;
+    CacheLine *lines = &cache.line[set * ways];
+    
+    for (int w = 0; w < ways; w++)
+        if (!lines[w].valid)
+            return w;
+    
+    switch (cache.config.replacement)
+    {
+        case REPLACE_LRU:
+        {
+            int victim = 0;
+            for (int w = 1; w < ways; w++)
+                if (lines[w].last_use < lines[victim].last_use)
+                    victim = w;
+            return victim;
+        }
+        case REPLACE_PLRU:
+            return plru_victim(cache, set);
+        case REPLACE_RANDOM:
+            return next_random(cache) % ways;
+        case REPLACE_SRRIP:
+        case REPLACE_BRRIP:
+            // First line predicted for distant re-reference, aging the
+            // whole set until one appears
+            for (;;)
+            {
+                for (int w = 0; w < ways; w++)
+                    if (lines[w].rrpv >= RRPV_MAX)
+                        return w;
+                for (int w = 0; w < ways; w++)
+                    lines[w].rrpv++;
+            }
+    }
+    return 0;
+}
+
+// Line holding address, or -1, leaving the replacement state alone
+int cache_probe(const Cache &cache, uint8_t address)
+{
+    int set = cache_set_index(cache, address);
+    uint8_t tag = cache_tag(cache, address);
+    int ways = cache.config.ways;
+    const CacheLine *lines = &cache.line[set * ways];
+    
+    for (int w = 0; w < ways; w++)
+        if (lines[w].valid && lines[w].tag == tag)
+            return set * ways + w;
+    return -1;
+}
+
+// Line holding address, or -1. A hit updates the replacement state.
+int cache_lookup(Cache &cache, uint8_t address)
+{
+    int index = cache_probe(cache, address);
+    if (index >= 0)
+        touch_line(cache, index / cache.config.ways, index % cache.config.ways);
+    return index;
+}
+
+// Choose a victim in address's set, write it back if dirty, load the block and return the line
+int cache_fill(Cache &cache, uint8_t address, uint8_t *memory, int &evicted, bool &evicted_dirty)
+{
+    int set = cache_set_index(cache, address);
+    int way = choose_victim(cache, set);
+    int index = set * cache.config.ways + way;
+    CacheLine &line = cache.line[index];
+    int block_size = cache.config.block_size;
+    
+    evicted = -1;
+    evicted_dirty = false;
+    if (line.valid)
+    {
+        evicted = ((line.tag << cache.index_bits) | set) << cache.offset_bits;
+        evicted_dirty = line.dirty;
+        if (evicted_dirty && memory != nullptr)
+        {
+            for (int i = 0; i < block_size; i++)
+                memory[evicted + i] = cache.data[index * block_size + i];
+        }
+    }
+    
+    line.valid = true;
+    line.dirty = false;
+    line.prefetched = false;
+    line.tag = cache_tag(cache, address);
+    
+    if (memory != nullptr)
+    {
+        int base = address & ~(block_size - 1);
+        for (int i = 0; i < block_size; i++)
+            cache.data[index * block_size + i] = memory[base + i];
+    }
+    
+    insert_line(cache, set, way);
+    return index;
+}
+
+// Invalidate the line holding address, writing it back if dirty
+bool cache_invalidate(Cache &cache, uint8_t address, uint8_t *memory, bool &dirty)
+{
+    int set = cache_set_index(cache, address);
+    uint8_t tag = cache_tag(cache, address);
+    int ways = cache.config.ways;
+    int block_size = cache.config.block_size;
+    
+    dirty = false;
+    for (int w = 0; w < ways; w++)
+    {
+        int index = set * ways + w;
+        CacheLine &line = cache.line[index];
+        if (!line.valid || line.tag != tag)
+            continue;
+        
+        dirty = line.dirty;
+        if (dirty && memory != nullptr)
+        {
+            int base = address & ~(block_size - 1);
+            for (int i = 0; i < block_size; i++)
+                memory[base + i] = cache.data[index * block_size + i];
+        }
+        line.valid = false;
+        line.dirty = false;
+        return true;
+    }
+    return false;
+}
+
+// Retire write buffer entries that have completed by now
+static void drain_write_buffer(WriteBuffer &buffer, uint64_t now)
+{
+    int done = 0;
+    while (done < buffer.count && buffer.done[done] <= now)
+        done++;
+    if (done == 0)
+        return;
+    
+    for (int i = done; i < buffer.count; i++)
+    {
+        buffer.block[i - done] = buffer.block[i];
+        buffer.done[i - done] = buffer.done[i];
+    }
+    buffer.count -= done;
+}
+
+// Send one block write to memory: through the write buffer when there is
+// one (waiting only if it is full), otherwise synchronously.
+// Returns the stall cycles.
+static int write_to_memory(SimulatorContext &ctx, uint8_t block)
+{
+    Cache &cache = ctx.cache;
+    int penalty = cache.config.miss_penalty;
+    
+    if (cache.config.write_buffer == 0)
+    {
+        ctx.memory_writes++;
+        return penalty;
+    }
+    
+    WriteBuffer &buffer = cache.write_buffer;
+    uint64_t now = ctx.cycle_count;
+    drain_write_buffer(buffer, now);
+    
+    for (int i = 0; i < buffer.count; i++)
+    {
+        if (buffer.block[i] == block)
+        {
+            ctx.write_buffer_coalesced++;
+            return 0;
+        }
+    }
+    
+    int stall = 0;
+    if (buffer.count == cache.config.write_buffer)
+    {
+        // Full: wait for the oldest write to complete
+        stall = (int)(buffer.done[0] - now);
+        now = buffer.done[0];
+        drain_write_buffer(buffer, now);
+        ctx.write_buffer_stalls += stall;
+    }
+    
+    uint64_t start = buffer.count > 0 ? buffer.done[buffer.count - 1] : now;
+    if (start < now)
+        start = now;
+    buffer.block[buffer.count] = block;
+    buffer.done[buffer.count] = start + penalty;
+    buffer.count++;
+    ctx.memory_writes++;
+    return stall;
+}
+
+// 3C bookkeeping for a demand access (miss = the L1 missed): the shadow
+// sees every access; a miss is compulsory on the block's first touch,
+// capacity if the shadow missed too, and conflict otherwise
+static void classify_access(SimulatorContext &ctx, uint8_t address, bool miss)
+{
+    int block = address >> ctx.cache.offset_bits;
+    int set = cache_set_index(ctx.cache, address);
+    bool first_touch = ((ctx.touched_blocks[block / 32] >> (block % 32)) & 1) == 0;
+    ctx.touched_blocks[block / 32] |= 1u << (block % 32);
+    
+    bool shadow_hit = cache_lookup(ctx.shadow_cache, address) >= 0;
+    if (!shadow_hit)
+    {
+        int evicted;
+        bool evicted_dirty;
+        cache_fill(ctx.shadow_cache, address, nullptr, evicted, evicted_dirty);
+    }
+    
+    ctx.set_accesses[set]++;
+    if (!miss)
+        return;
+    ctx.set_misses[set]++;
+    if (first_touch)
+    {
+        ctx.compulsory_misses++;
+    }
+    else if (!shadow_hit)
+    {
+        ctx.capacity_misses++;
+    }
+    else
+    {
+        ctx.conflict_misses++;
+        ctx.set_conflicts[set]++;
+    }
+}
+
+// Retire MSHR entries whose fill has completed by now
+static void retire_mshrs(MSHRFile &mshr, uint64_t now)
+{
+    int kept = 0;
+    for (int i = 0; i < mshr.count; i++)
+    {
+        if (mshr.ready[i] <= now)
+            continue;
+        mshr.block[kept] = mshr.block[i];
+        mshr.ready[kept] = mshr.ready[i];
+        kept++;
+    }
+    mshr.count = kept;
+}
+
+// Outstanding MSHR entry for block, or -1
+static int find_mshr(SimulatorContext &ctx, uint8_t block)
+{
+    MSHRFile &mshr = ctx.cache.mshr;
+    retire_mshrs(mshr, ctx.cycle_count);
+    for (int i = 0; i < mshr.count; i++)
+        if (mshr.block[i] == block)
+            return i;
+    return -1;
+}
+
+// Track a miss whose fill takes fill_cycles beyond this cycle in a free
+// MSHR, first waiting for the earliest fill if all are busy. Sets ready
+// to the cycle the data is usable; returns the cycles waited.
+static int allocate_mshr(SimulatorContext &ctx, uint8_t block, int fill_cycles, uint64_t &ready)
+{
+    MSHRFile &mshr = ctx.cache.mshr;
+    uint64_t now = ctx.cycle_count;
+    int stall = 0;
+    
+    retire_mshrs(mshr, now);
+    if (mshr.count == ctx.cache_config.mshrs)
+    {
+        uint64_t earliest = mshr.ready[0];
+        for (int i = 1; i < mshr.count; i++)
+            if (mshr.ready[i] < earliest)
+                earliest = mshr.ready[i];
+        stall = (int)(earliest - now);
+        now = earliest;
+        retire_mshrs(mshr, now);
+        ctx.mshr_full_stalls += stall;
+    }
+    
+    ready = now + fill_cycles + 1;
+    mshr.block[mshr.count] = block;
+    mshr.ready[mshr.count] = ready;
+    mshr.count++;
+    if ((uint64_t)mshr.count > ctx.mshr_peak)
+        ctx.mshr_peak = mshr.count;
+    
+    // Misses issue in cycle order, so the busy time is a running union
+    ctx.miss_latency_cycles += ready - now;
+    uint64_t start = now > ctx.mshr_busy_until ? now : ctx.mshr_busy_until;
+    if (ready > start)
+        ctx.mshr_busy_cycles += ready - start;
+    if (ready > ctx.mshr_busy_until)
+        ctx.mshr_busy_until = ready;
+    return stall;
+}
+
+// Hierarchy levels: 0 is the L1 (ctx.cache), 1.. the lower levels
+static Cache &level_cache(SimulatorContext &ctx, int level)
+{
+    return level == 0 ? ctx.cache : ctx.lower_cache[level - 1];
+}
+
+static int level_count(const SimulatorContext &ctx)
+{
+    return 1 + ctx.hierarchy_config.lower_levels;
+}
+
+static InclusionPolicy level_inclusion(const SimulatorContext &ctx, int level)
+{
+    return ctx.hierarchy_config.level[level - 1].inclusion;
+}
+
+// Where fetch_block() found a block: 0 = victim cache, level_count() = memory
+static string source_name(const SimulatorContext &ctx, int source)
+{
+    if (source == 0)
+        return "victim cache";
+    return source == level_count(ctx) ? string("memory") : "L" + to_string(source + 1);
+}
+
+static int fill_level(SimulatorContext &ctx, int level, uint8_t address, int &stall_cycles);
+
+// Invalidate every copy above level of a block evicted from it
+// (inclusive levels). Returns true if one of them was dirty.
+static bool back_invalidate(SimulatorContext &ctx, int level, uint8_t block)
+{
+    int size = level_cache(ctx, level).config.block_size;
+    bool any_dirty = false;
+    for (int above = 0; above < level; above++)
+    {
+        Cache &cache = level_cache(ctx, above);
+        for (int address = block; address < block + size; address += cache.config.block_size)
+        {
+            bool dirty;
+            if (cache_invalidate(cache, (uint8_t)address, above == 0 ? ctx.data_memory : nullptr, dirty))
+            {
+                ctx.lower_cache_stats[level - 1].back_invalidations++;
+                any_dirty = any_dirty || dirty;
+            }
+        }
+    }
+    
+    // The victim cache sits between the L1 and level 1
+    if (ctx.cache_config.victim_lines > 0)
+    {
+        for (int address = block; address < block + size; address += ctx.cache_config.block_size)
+        {
+            bool dirty;
+            if (cache_invalidate(ctx.victim_cache, (uint8_t)address, nullptr, dirty))
+            {
+                ctx.lower_cache_stats[level - 1].back_invalidations++;
+                any_dirty = any_dirty || dirty;
+            }
+        }
+    }
+    return any_dirty;
+}
+
+// Pass a block evicted from level down: a dirty block is written back
+// (allocating it if needed), a clean one only goes to an exclusive level
+static void write_below(SimulatorContext &ctx, int level, uint8_t block, bool dirty, int &stall_cycles)
+{
+    int below = level + 1;
+    if (below == level_count(ctx))
+    {
+        if (dirty)
+            stall_cycles += write_to_memory(ctx, block);
+        return;
+    }
+    
+    if (!dirty && level_inclusion(ctx, below) != INCLUSION_EXCLUSIVE)
+        return;
+    
+    Cache &cache = ctx.lower_cache[below - 1];
+    int index = cache_lookup(cache, block);
+    if (index < 0)
+        index = fill_level(ctx, below, block, stall_cycles);
+    if (dirty)
+    {
+        cache.line[index].dirty = true;
+        stall_cycles += cache.config.hit_cycles;
+    }
+}
+
+// Load address's block into level, sending its victim down; returns the
+// line and adds the write-backs' stall cycles
+static int fill_level(SimulatorContext &ctx, int level, uint8_t address, int &stall_cycles)
+{
+    int evicted;
+    bool evicted_dirty;
+    int index = cache_fill(level_cache(ctx, level), address, level == 0 ? ctx.data_memory : nullptr,
+                           evicted, evicted_dirty);
+    if (evicted < 0)
+        return index;
+    
+    // The L1's victim is parked in the victim cache, and whatever that
+    // pushes out continues down in its place
+    if (level == 0 && ctx.cache_config.victim_lines > 0)
+    {
+        bool dirty = evicted_dirty;
+        int parked = cache_fill(ctx.victim_cache, (uint8_t)evicted, nullptr, evicted, evicted_dirty);
+        ctx.victim_cache.line[parked].dirty = dirty;
+        if (evicted < 0)
+            return index;
+    }
+    
+    if (evicted_dirty)
+    {
+        if (level == 0)
+            ctx.cache_writebacks++;
+        else
+            ctx.lower_cache_stats[level - 1].writebacks++;
+    }
+    if (level > 0 && level_inclusion(ctx, level) == INCLUSION_INCLUSIVE)
+        evicted_dirty = back_invalidate(ctx, level, (uint8_t)evicted) || evicted_dirty;
+    
+    write_below(ctx, level, (uint8_t)evicted, evicted_dirty, stall_cycles);
+    return index;
+}
+
+// Bring address's block into the L1 from the nearest level holding it.
+// Sets fill_cycles to that level's latency - 1, stall_cycles to
+// fill_cycles plus any write-backs and source to that level
+// (0 for the victim cache, level_count() for memory); returns the L1 line.
+// Prefetch fills (demand false) leave the victim cache and lower-level
+// hit/miss counters alone, so they describe the program's own traffic.
+static int fetch_block(SimulatorContext &ctx, uint8_t address, bool demand, int &fill_cycles,
+                       int &stall_cycles, int &source)
+{
+    // A victim cache hit swaps the block back with the L1's victim
+    if (ctx.cache_config.victim_lines > 0)
+    {
+        bool dirty;
+        if (cache_invalidate(ctx.victim_cache, address, nullptr, dirty))
+        {
+            if (demand)
+                ctx.victim_hits++;
+            stall_cycles = ctx.cache_config.victim_swap_cycles - 1;
+            fill_cycles = stall_cycles;
+            int index = fill_level(ctx, 0, address, stall_cycles);
+            if (dirty)
+                ctx.cache.line[index].dirty = true;
+            source = 0;
+            return index;
+        }
+        if (demand)
+            ctx.victim_misses++;
+    }
+    
+    int levels = level_count(ctx);
+    int found = 1;
+    while (found < levels && cache_lookup(ctx.lower_cache[found - 1], address) < 0)
+    {
+        if (demand)
+            ctx.lower_cache_stats[found - 1].misses++;
+        found++;
+    }
+    
+    bool dirty = false;
+    if (found < levels)
+    {
+        if (demand)
+            ctx.lower_cache_stats[found - 1].hits++;
+        stall_cycles = ctx.lower_cache[found - 1].config.hit_cycles - 1;
+        
+        // An exclusive level hands the block (and its dirty state) up
+        if (level_inclusion(ctx, found) == INCLUSION_EXCLUSIVE)
+            cache_invalidate(ctx.lower_cache[found - 1], address, nullptr, dirty);
+    }
+    else
+    {
+        stall_cycles = ctx.cache_config.miss_penalty - 1;  // Memory
+    }
+    fill_cycles = stall_cycles;
+    
+    // Fill the levels that missed, lowest first so an inclusive level
+    // holds the block before the levels above it do
+    for (int level = found - 1; level >= 1; level--)
+        if (level_inclusion(ctx, level) != INCLUSION_EXCLUSIVE)
+            fill_level(ctx, level, address, stall_cycles);
+    
+    int index = fill_level(ctx, 0, address, stall_cycles);
+    if (dirty)
+        ctx.cache.line[index].dirty = true;
+    source = found;
+    return index;
+}
+
+// Write dirty lines back to data memory without timing or counters
+void sync_cache_to_memory(SimulatorContext &ctx)
+{
+    Cache &cache = ctx.cache;
+    int block_size = cache.config.block_size;
+    for (int i = 0; i < cache.config.lines; i++)
+    {
+        CacheLine &line = cache.line[i];
+        if (!line.valid || !line.dirty)
+            continue;
+        
+        int set = i / cache.config.ways;
+        int base = ((line.tag << cache.index_bits) | set) << cache.offset_bits;
+        for (int b = 0; b < block_size; b++)
+            ctx.data_memory[base + b] = cache.data[i * block_size + b];
+    }
+}
+
+// Demand load: hit, merge into an outstanding miss, or fetch the block
+template <class Trace>
+static uint8_t demand_read(SimulatorContext &ctx, uint8_t address, bool &hit_flag, int &stall_cycles,
+                           int &pending_cycles)
+{
+    Cache &cache = ctx.cache;
+    bool nonblocking = (cache.config.mshrs > 0);
+    int block_size = cache.config.block_size;
+    int offset = cache_block_offset(cache, address);
+    uint8_t block = address & ~(block_size - 1);
+    pending_cycles = 0;
+    
+    // Non-blocking: a block that is still being filled is a secondary
+    // miss, served when the outstanding fill completes (unless another
+    // fill has already evicted it again)
+    int entry = nonblocking ? find_mshr(ctx, block) : -1;
+    int index = cache_lookup(cache, address);
+    if (entry >= 0 && index >= 0)
+    {
+        hit_flag = false;
+        stall_cycles = 0;
+        pending_cycles = (int)(cache.mshr.ready[entry] - ctx.cycle_count - 1);
+        ctx.cache_misses++;
+        ctx.mshr_merges++;
+        classify_access(ctx, address, false);  // Merged misses are not classified
+        
+        uint8_t data = cache.data[index * block_size + offset];
+        if (Trace::enabled)
+        {
+            *ctx.out << "    [CACHE] MISS at address 0x" << hex << (int)address << dec
+                 << " -> merged into outstanding miss, data in " << pending_cycles + 1 << " cycles" << endl;
+            
+            logger1("CACHE MISS: address=0x" + to_string(address) + " merged, pending_cycles=" +
+                   to_string(pending_cycles));
+        }
+        return data;
+    }
+    
+    if (index >= 0)
     {
         // Cache HIT
         hit_flag = true;
-        stall_cycles = 0;  // Hit takes 1 cycle (no additional stall)
-        cache_hits++;
+        stall_cycles = ctx.cache_config.hit_cycles - 1;  // Hit beyond 1 cycle stalls
         
-        cout << "    [CACHE] HIT at address 0x" << hex << (int)address << dec
-             << " (index=" << (int)index << ", tag=" << (int)tag << ")"
-             << " -> data=0x" << hex << (int)cache[index].data << dec << endl;
+        // First demand use of a prefetched line; a late one waits for
+        // the rest of its fill
+        CacheLine &line = cache.line[index];
+        if (line.prefetched)
+        {
+            line.prefetched = false;
+            int fill_wait = (int)(line.prefetch_ready - ctx.cycle_count) - 1;
+            if (fill_wait > stall_cycles)
+            {
+                stall_cycles = fill_wait;
+                ctx.prefetch_late++;
+            }
+            else
+            {
+                ctx.prefetch_useful++;
+            }
+        }
+        if (nonblocking)
+        {
+            pending_cycles = stall_cycles;  // Pipelined: only dependents wait
+            stall_cycles = 0;
+        }
+        ctx.cache_stall_cycles += stall_cycles;
+        ctx.cache_hits++;
+        classify_access(ctx, address, false);
         
-        logger1("CACHE HIT: address=0x" + to_string(address) + 
-               " index=" + to_string(index) + " tag=" + to_string(tag) +
-               " data=0x" + to_string(cache[index].data));
+        uint8_t data = cache.data[index * block_size + offset];
+        if (Trace::enabled)
+        {
+            int set = cache_set_index(cache, address);
+            int tag = cache_tag(cache, address);
+            *ctx.out << "    [CACHE] HIT at address 0x" << hex << (int)address << dec
+                 << " (index=" << set << ", tag=" << tag << ")"
+                 << " -> data=0x" << hex << (int)data << dec << endl;
+            
+            logger1("CACHE HIT: address=0x" + to_string(address) + 
+                   " index=" + to_string(set) + " tag=" + to_string(tag) +
+                   " data=0x" + to_string(data));
+        }
         
-        return cache[index].data;
+        return data;
     }
     else
     {
-        // Cache MISS - need to fetch from main memory
+        // Cache MISS - need to fetch the block from main memory
         hit_flag = false;
-        stall_cycles = CACHE_MISS_PENALTY - 1;  // Miss penalty cycles (minus current cycle)
-        cache_misses++;
-        cache_stall_cycles += stall_cycles;
+        ctx.cache_misses++;
+        classify_access(ctx, address, true);
         
-        // Fetch from main memory
-        uint8_t data = read_data_memory(address);
+        // Latency of the level that had the block (minus current cycle)
+        int fill_cycles, source;
+        index = fetch_block(ctx, address, true, fill_cycles, stall_cycles, source);
+        if (nonblocking)
+        {
+            // The fill overlaps execution; dependents wait for ready
+            uint64_t ready;
+            stall_cycles += allocate_mshr(ctx, block, fill_cycles, ready) - fill_cycles;
+            pending_cycles = (int)(ready - ctx.cycle_count - 1);
+        }
+        ctx.cache_stall_cycles += stall_cycles;
+        uint8_t data = cache.data[index * block_size + offset];
         
-        // Update cache line
-        cache[index].valid = true;
-        cache[index].tag = tag;
-        cache[index].data = data;
+        if (Trace::enabled)
+        {
+            int set = cache_set_index(cache, address);
+            int tag = cache_tag(cache, address);
+            *ctx.out << "    [CACHE] MISS at address 0x" << hex << (int)address << dec
+                 << " (index=" << set << ", tag=" << tag << ")"
+                 << " -> fetching from "
+                 << source_name(ctx, source)
+                 << ", stall " << stall_cycles << " cycles";
+            if (nonblocking)
+                *ctx.out << ", data in " << pending_cycles + 1 << " cycles ("
+                     << cache.mshr.count << "/" << cache.config.mshrs << " MSHRs)";
+            *ctx.out << endl;
+            
+            logger1("CACHE MISS: address=0x" + to_string(address) + 
+                   " index=" + to_string(set) + " tag=" + to_string(tag) +
+                   " fetched data=0x" + to_string(data) + " stall_cycles=" + to_string(stall_cycles));
+        }
         
-        cout << "    [CACHE] MISS at address 0x" << hex << (int)address << dec
-             << " (index=" << (int)index << ", tag=" << (int)tag << ")"
-             << " -> fetching from memory, stall " << stall_cycles << " cycles" << endl;
+        return data;
+    }
+}
+
+// Train the prefetcher on a demand load and fill the blocks it names
+// that are not cached yet. The fills run in the background: the line is
+// tagged with the cycle its data arrives, and write-backs of its victim
+// never stall the pipeline.
+template <class Trace>
+static void issue_prefetches(SimulatorContext &ctx, uint8_t pc, uint8_t address)
+{
+    Cache &cache = ctx.cache;
+    int blocks[MAX_PREFETCH_CANDIDATES];
+    int count = prefetcher_observe(ctx.prefetcher, cache.config.prefetcher, cache.config.block_size,
+                                   pc, address, blocks);
+    for (int i = 0; i < count; i++)
+    {
+        uint8_t block = (uint8_t)blocks[i];
+        if (cache_probe(cache, block) >= 0)
+            continue;
         
-        logger1("CACHE MISS: address=0x" + to_string(address) + 
-               " index=" + to_string(index) + " tag=" + to_string(tag) +
-               " fetched data=0x" + to_string(data) + " stall_cycles=" + to_string(stall_cycles));
+        int fill_cycles, stall_cycles, source;
+        int index = fetch_block(ctx, block, false, fill_cycles, stall_cycles, source);
+        cache.line[index].prefetched = true;
+        cache.line[index].prefetch_ready = ctx.cycle_count + fill_cycles + 1;
+        ctx.prefetch_issued++;
         
-        return data;
+        if (Trace::enabled)
+        {
+            *ctx.out << "    [PREFETCH] block 0x" << hex << (int)block << dec << " from "
+                 << source_name(ctx, source)
+                 << ", ready in " << fill_cycles + 1 << " cycles" << endl;
+            
+            logger1("PREFETCH: block=0x" + to_string(block) + " fill_cycles=" + to_string(fill_cycles));
+        }
     }
 }
 
-// Cache write function (write-through policy)
-int cache_write(uint8_t address, uint8_t data)
+// Cache read function
+template <class Trace>
+uint8_t cache_read(SimulatorContext &ctx, uint8_t pc, uint8_t address, bool &hit_flag, int &stall_cycles,
+                   int &pending_cycles)
+{
+    uint8_t data = demand_read<Trace>(ctx, address, hit_flag, stall_cycles, pending_cycles);
+    if (ctx.cache_config.prefetcher != PREFETCH_NONE)
+        issue_prefetches<Trace>(ctx, pc, address);
+    return data;
+}
+
+// Cache write function (write-through or write-back)
+template <class Trace>
+int cache_write(SimulatorContext &ctx, uint8_t address, uint8_t data)
 {
-    uint8_t index = get_cache_index(address);
-    uint8_t tag = get_cache_tag(address);
+    Cache &cache = ctx.cache;
+    bool write_back = (cache.config.write_policy == WRITE_BACK);
+    bool buffered = (cache.config.write_buffer > 0);
+    bool nonblocking = (cache.config.mshrs > 0);
+    int block_size = cache.config.block_size;
+    uint8_t block = address & ~(block_size - 1);
     
-    // Write-through: always write to memory
-    write_data_memory(address, data);
+    // Write-through: memory is always written (timing below)
+    if (!write_back)
+        write_data_memory(ctx, address, data);
     
-    // Update cache if line is valid and matches
-    if (cache[index].valid && cache[index].tag == tag)
+    // Update cache if the block is present (or merge into its
+    // outstanding fill)
+    bool merged = nonblocking && find_mshr(ctx, block) >= 0;
+    int index = cache_lookup(cache, address);
+    if (index >= 0)
     {
         // Cache line exists - update it
-        cache[index].data = data;
-        cache_hits++;
+        cache.data[index * block_size + cache_block_offset(cache, address)] = data;
+        if (cache.line[index].prefetched)
+        {
+            cache.line[index].prefetched = false;  // Stores never wait for the fill
+            ctx.prefetch_useful++;
+        }
+        if (merged)
+        {
+            ctx.cache_misses++;
+            ctx.mshr_merges++;
+        }
+        else
+        {
+            ctx.cache_hits++;
+        }
+        classify_access(ctx, address, false);  // Merged misses are not classified
         
-        cout << "    [CACHE] WRITE HIT at address 0x" << hex << (int)address << dec
-             << " -> updated cache and memory" << endl;
+        if (Trace::enabled)
+        {
+            *ctx.out << "    [CACHE] " << (merged ? "WRITE MISS (merged)" : "WRITE HIT")
+                 << " at address 0x" << hex << (int)address << dec
+                 << (write_back ? " -> updated cache (dirty)" : " -> updated cache and memory") << endl;
+            
+            logger1("CACHE WRITE HIT: address=0x" + to_string(address) + 
+                   " data=0x" + to_string(data));
+        }
         
-        logger1("CACHE WRITE HIT: address=0x" + to_string(address) + 
-               " data=0x" + to_string(data));
+        // No additional stall for a single-cycle write hit (or any
+        // write hit of a non-blocking cache)
+        int stall_cycles = nonblocking ? 0 : ctx.cache_config.hit_cycles - 1;
+        if (write_back)
+            cache.line[index].dirty = true;
+        else if (buffered)
+            stall_cycles += write_to_memory(ctx, block);
+        else
+            ctx.memory_writes++;
+        ctx.cache_stall_cycles += stall_cycles;
+        return stall_cycles;
+    }
+    
+    ctx.cache_misses++;
+    classify_access(ctx, address, true);
+    
+    if (!write_back && buffered)
+    {
+        // Write-through with a write buffer: no allocate, the store
+        // retires as soon as the buffer takes it
+        int stall_cycles = (nonblocking ? 0 : ctx.cache_config.hit_cycles - 1) + write_to_memory(ctx, block);
+        ctx.cache_stall_cycles += stall_cycles;
         
-        return 0;  // No additional stall for write hit
+        if (Trace::enabled)
+        {
+            *ctx.out << "    [CACHE] WRITE MISS at address 0x" << hex << (int)address << dec
+                 << " -> queued in write buffer (" << cache.write_buffer.count << "/"
+                 << cache.config.write_buffer << ")" << endl;
+            
+            logger1("CACHE WRITE MISS: address=0x" + to_string(address) + 
+                   " data=0x" + to_string(data) + " (write buffer)");
+        }
+        return stall_cycles;
+    }
+    
+    // Cache miss on write - allocate the block (write-allocate). For
+    // simplicity, treat write misses with same penalty as read misses.
+    int fill_cycles, stall_cycles, source;
+    index = fetch_block(ctx, address, true, fill_cycles, stall_cycles, source);
+    if (nonblocking)
+    {
+        uint64_t ready;
+        stall_cycles += allocate_mshr(ctx, block, fill_cycles, ready) - fill_cycles;
+    }
+    if (write_back)
+    {
+        cache.data[index * block_size + cache_block_offset(cache, address)] = data;
+        cache.line[index].dirty = true;
     }
     else
     {
-        // Cache miss on write - allocate new line (write-allocate)
-        cache[index].valid = true;
-        cache[index].tag = tag;
-        cache[index].data = data;
-        cache_misses++;
-        
-        cout << "    [CACHE] WRITE MISS at address 0x" << hex << (int)address << dec
-             << " -> allocating cache line, writing to memory" << endl;
+        ctx.memory_writes++;   // Memory already holds the new byte
+    }
+    ctx.cache_stall_cycles += stall_cycles;
+    
+    if (Trace::enabled)
+    {
+        *ctx.out << "    [CACHE] WRITE MISS at address 0x" << hex << (int)address << dec
+             << (write_back ? " -> allocating cache line (dirty)"
+                            : " -> allocating cache line, writing to memory") << endl;
         
         logger1("CACHE WRITE MISS: address=0x" + to_string(address) + 
                " data=0x" + to_string(data) + " (write-allocate)");
+    }
+    
+    return stall_cycles;
+}
+
+// I-cache access for the fetch of pc
+template <class Trace>
+int icache_fetch(SimulatorContext &ctx, uint8_t pc, bool &hit_flag)
+{
+    Cache &cache = ctx.icache;
+    int stall_cycles;
+    
+    hit_flag = cache_lookup(cache, pc) >= 0;
+    if (hit_flag)
+    {
+        stall_cycles = ctx.icache_config.hit_cycles - 1;
+        ctx.icache_hits++;
+    }
+    else
+    {
+        stall_cycles = ctx.icache_config.miss_penalty - 1;
+        ctx.icache_misses++;
         
-        // For simplicity, treat write misses with same penalty
-        int stall_cycles = CACHE_MISS_PENALTY - 1;
-        cache_stall_cycles += stall_cycles;
-        return stall_cycles;
+        int evicted;
+        bool evicted_dirty;
+        cache_fill(cache, pc, nullptr, evicted, evicted_dirty);
+        
+        if (Trace::enabled)
+        {
+            *ctx.out << "  [ICACHE] MISS at PC=0x" << hex << (int)pc << dec
+                 << " (index=" << (int)cache_set_index(cache, pc) << ", tag=" << (int)cache_tag(cache, pc) << ")"
+                 << " -> fetching from instruction memory, stall " << stall_cycles << " cycles" << endl;
+            
+            logger1("ICACHE MISS: pc=0x" + to_string(pc) + " stall_cycles=" + to_string(stall_cycles));
+        }
     }
+    
+    ctx.icache_stall_cycles += stall_cycles;
+    return stall_cycles;
 }
 
+template uint8_t cache_read<QuietTrace>(SimulatorContext &, uint8_t, uint8_t, bool &, int &, int &);
+template uint8_t cache_read<VerboseTrace>(SimulatorContext &, uint8_t, uint8_t, bool &, int &, int &);
+template int cache_write<QuietTrace>(SimulatorContext &, uint8_t, uint8_t);
+template int cache_write<VerboseTrace>(SimulatorContext &, uint8_t, uint8_t);
+template int icache_fetch<QuietTrace>(SimulatorContext &, uint8_t, bool &);
+template int icache_fetch<VerboseTrace>(SimulatorContext &, uint8_t, bool &);
+
 // Display cache contents
-void display_cache()
+void display_cache(SimulatorContext &ctx)
 {
+    const Cache &cache = ctx.cache;
+    int block_size = cache.config.block_size;
+    
     cout << "\n=== CACHE CONTENTS ===" << endl;
-    cout << "Line | Valid | Tag  | Data" << endl;
-    cout << "-----|-------|------|--------" << endl;
     
-    for (int i = 0; i < CACHE_LINES; i++)
+    // Original direct-mapped, 1-byte-block layout
+    if (cache.config.ways == 1 && block_size == 1)
+    {
+        cout << "Line | Valid | Tag  | Data" << endl;
+        cout << "-----|-------|------|--------" << endl;
+        
+        for (int i = 0; i < cache.config.lines; i++)
+        {
+            cout << "  " << i << "  |   " << (cache.line[i].valid ? "1" : "0") 
+                 << "   | 0x" << hex << setw(2) << setfill('0') << (int)cache.line[i].tag
+                 << " | 0x" << setw(2) << setfill('0') << (int)cache.data[i] 
+                 << dec << setfill(' ') << endl;
+        }
+        cout << endl;
+        return;
+    }
+    
+    cout << describe_cache_config(cache.config) << endl;
+    cout << "Set | Way | Valid | Tag  | Data" << endl;
+    cout << "----|-----|-------|------|--------" << endl;
+    
+    for (int i = 0; i < cache.config.lines; i++)
     {
-        cout << "  " << i << "  |   " << (cache[i].valid ? "1" : "0") 
-             << "   | 0x" << hex << setw(2) << setfill('0') << (int)cache[i].tag
-             << " | 0x" << setw(2) << setfill('0') << (int)cache[i].data 
-             << dec << setfill(' ') << endl;
+        cout << setfill(' ') << setw(3) << i / cache.config.ways << " | " << setw(3) << i % cache.config.ways
+             << " |   " << (cache.line[i].valid ? "1" : "0")
+             << "   | 0x" << hex << setw(2) << setfill('0') << (int)cache.line[i].tag << " |";
+        for (int b = 0; b < block_size; b++)
+            cout << " " << setw(2) << setfill('0') << (int)cache.data[i * block_size + b];
+        cout << dec << setfill(' ') << endl;
     }
     cout << endl;
 }
 
 // Display cache statistics
-void display_cache_stats()
+void display_cache_stats(SimulatorContext &ctx)
 {
     double hit_rate = 0.0;
-    uint64_t total_accesses = cache_hits + cache_misses;
+    uint64_t total_accesses = ctx.cache_hits + ctx.cache_misses;
     
     if (total_accesses > 0)
     {
-        hit_rate = (double)cache_hits / (double)total_accesses * 100.0;
+        hit_rate = (double)ctx.cache_hits / (double)total_accesses * 100.0;
     }
     
     cout << "\n=====================================" << endl;
     cout << "      CACHE STATISTICS" << endl;
     cout << "=====================================" << endl;
-    cout << "Cache Hits:          " << cache_hits << endl;
-    cout << "Cache Misses:        " << cache_misses << endl;
+    cout << "Cache Hits:          " << ctx.cache_hits << endl;
+    cout << "Cache Misses:        " << ctx.cache_misses << endl;
     cout << "Total Accesses:      " << total_accesses << endl;
     cout << "Hit Rate:            " << fixed << setprecision(2) << hit_rate << "%" << endl;
-    cout << "Cache Stall Cycles:  " << cache_stall_cycles << endl;
+    cout << "Cache Stall Cycles:  " << ctx.cache_stall_cycles << endl;
+    cout << "Compulsory Misses:   " << ctx.compulsory_misses << endl;
+    cout << "Capacity Misses:     " << ctx.capacity_misses << endl;
+    cout << "Conflict Misses:     " << ctx.conflict_misses << endl;
+    if (ctx.cache_config.victim_lines > 0)
+    {
+        cout << "Victim Hits:         " << ctx.victim_hits << endl;
+        cout << "Victim Misses:       " << ctx.victim_misses << endl;
+    }
+    cout << "Write-backs:         " << ctx.cache_writebacks << endl;
+    cout << "Memory Writes:       " << ctx.memory_writes << endl;
+    cout << "Write Buffer Stalls: " << ctx.write_buffer_stalls << endl;
+    cout << "Write Buffer Merges: " << ctx.write_buffer_coalesced << endl;
+    if (ctx.cache_config.mshrs > 0)
+    {
+        // Memory-level parallelism: misses outstanding per busy cycle
+        double mlp = ctx.mshr_busy_cycles > 0 ? (double)ctx.miss_latency_cycles / ctx.mshr_busy_cycles : 0.0;
+        cout << "MSHRs:               " << ctx.cache_config.mshrs << endl;
+        cout << "MSHR Merges:         " << ctx.mshr_merges << endl;
+        cout << "MSHR Full Stalls:    " << ctx.mshr_full_stalls << endl;
+        cout << "Dependency Stalls:   " << ctx.mshr_dependency_stalls << endl;
+        cout << "Peak Outstanding:    " << ctx.mshr_peak << endl;
+        cout << "Average MLP:         " << mlp << endl;
+    }
+    if (ctx.cache_config.prefetcher != PREFETCH_NONE)
+    {
+        // Useless: evicted or still unused at the end of the run
+        uint64_t used = ctx.prefetch_useful + ctx.prefetch_late;
+        cout << "Prefetcher:          " << prefetch_policy_name(ctx.cache_config.prefetcher) << endl;
+        cout << "Prefetches Issued:   " << ctx.prefetch_issued << endl;
+        cout << "Prefetches Useful:   " << ctx.prefetch_useful << endl;
+        cout << "Prefetches Late:     " << ctx.prefetch_late << endl;
+        cout << "Prefetches Useless:  " << ctx.prefetch_issued - used << endl;
+    }
+    
+    // Lower levels: demand accesses are the misses of the level above
+    for (int i = 0; i < ctx.hierarchy_config.lower_levels; i++)
+    {
+        const CacheLevelStats &stats = ctx.lower_cache_stats[i];
+        uint64_t accesses = stats.hits + stats.misses;
+        double level_rate = accesses > 0 ? (double)stats.hits / (double)accesses * 100.0 : 0.0;
+        string name = "L" + to_string(i + 2);
+        
+        cout << "-------------------------------------" << endl;
+        cout << name << ": " << describe_cache_level(ctx.hierarchy_config.level[i]) << endl;
+        cout << left;
+        cout << setw(21) << name + " Hits:" << stats.hits << endl;
+        cout << setw(21) << name + " Misses:" << stats.misses << endl;
+        cout << setw(21) << name + " Hit Rate:" << level_rate << "%" << endl;
+        cout << setw(21) << name + " Write-backs:" << stats.writebacks << endl;
+        cout << setw(21) << name + " Back-invals:" << stats.back_invalidations << endl;
+        cout << right;
+    }
+    
+    if (ctx.icache_config.lines > 0)
+    {
+        uint64_t fetches = ctx.icache_hits + ctx.icache_misses;
+        double fetch_rate = fetches > 0 ? (double)ctx.icache_hits / (double)fetches * 100.0 : 0.0;
+        
+        cout << "-------------------------------------" << endl;
+        cout << "I-cache: " << describe_cache_config(ctx.icache_config) << endl;
+        cout << "I-cache Hits:        " << ctx.icache_hits << endl;
+        cout << "I-cache Misses:      " << ctx.icache_misses << endl;
+        cout << "I-cache Hit Rate:    " << fetch_rate << "%" << endl;
+        cout << "I-cache Stalls:      " << ctx.icache_stall_cycles << endl;
+    }
     cout << "=====================================" << endl;
     cout << endl;
 }
+
+// Write the per-set counters as CSV
+bool write_set_heatmap(const SimulatorContext &ctx, const string &path)
+{
+    ofstream file(path.c_str());
+    if (!file.is_open())
+    {
+        cerr << "Error: Could not open " << path << endl;
+        return false;
+    }
+    
+    file << "set,accesses,misses,conflict_misses,miss_rate\n";
+    for (int set = 0; set < ctx.cache.sets; set++)
+    {
+        char rate[32];
+        snprintf(rate, sizeof(rate), "%.4f",
+                 ctx.set_accesses[set] > 0 ? (double)ctx.set_misses[set] / ctx.set_accesses[set] : 0.0);
+        file << set << ',' << ctx.set_accesses[set] << ',' << ctx.set_misses[set] << ','
+             << ctx.set_conflicts[set] << ',' << rate << '\n';
+    }
+    return true;
+}
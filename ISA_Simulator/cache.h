@@ -3,57 +3,337 @@
 
 #include <cstdint>
 #include <iostream>
+#include <string>
+#include "trace_policy.h"
+#include "prefetcher.h"
+
+using namespace std;
 
 // Cache Configuration
-// Direct-mapped cache with 8 lines
-// Each line holds 1 byte (block size = 1 byte)
-// Address = [TAG (5 bits) | INDEX (3 bits)]
+// Set-associative cache: lines / ways sets of `ways` lines, each line
+// holding a block of block_size bytes.
+// Address = [TAG | SET INDEX (log2 sets) | OFFSET (log2 block_size)]
+// The defaults below are the original direct-mapped layout: 8 lines,
+// 1-byte blocks, so Address = [TAG (5 bits) | INDEX (3 bits)].
+// Each SimulatorContext carries its own CacheConfig so sweeps can vary
+// them without recompiling.
 
 #define CACHE_LINES 8           // Number of cache lines
-#define INDEX_BITS 3            // log2(CACHE_LINES)
-#define TAG_BITS 5              // 8 - INDEX_BITS (for 8-bit address)
+#define CACHE_WAYS 1            // Lines per set (1 = direct-mapped)
+#define CACHE_BLOCK_SIZE 1      // Bytes per line
 #define CACHE_HIT_CYCLES 1      // Cycles for cache hit
 #define CACHE_MISS_PENALTY 5    // Cycles for cache miss (memory access)
+#define MAX_CACHE_LINES 256     // One line per byte of the 8-bit address space
+#define MAX_CACHE_BYTES 256     // Capacity limit (lines * block_size)
+
+// Replacement policies (CacheConfig::replacement)
+enum ReplacementPolicy
+{
+    REPLACE_LRU,        // Least recently used (per-line timestamps)
+    REPLACE_PLRU,       // Tree pseudo-LRU (ways - 1 bits per set)
+    REPLACE_RANDOM,     // Random way (fixed seed, reproducible)
+    REPLACE_SRRIP,      // Static RRIP: 2-bit RRPV, insert at "long"
+    REPLACE_BRRIP       // Bimodal RRIP: insert at "distant", 1 in 32 at "long"
+};
 
-// Cache Line Structure
+#define CACHE_REPLACEMENT REPLACE_LRU
+
+// Write policies (CacheConfig::write_policy)
+enum WritePolicy
+{
+    WRITE_THROUGH,      // Every store writes memory (write-allocate without a write buffer)
+    WRITE_BACK          // Stores mark the line dirty; dirty victims are written back
+};
+
+#define CACHE_WRITE_POLICY WRITE_THROUGH
+#define CACHE_WRITE_BUFFER 0    // Write buffer entries (0 = no buffer)
+#define MAX_WRITE_BUFFER 64
+#define CACHE_MSHRS 0           // Miss status holding registers (0 = blocking cache)
+#define MAX_MSHRS 16
+#define VICTIM_LINES 0          // Victim cache lines (0 = none)
+#define VICTIM_SWAP_CYCLES 2    // Latency of a victim cache hit (swap with the L1 line)
+#define MAX_VICTIM_LINES 16
+
+// Runtime cache configuration (the L1 data cache; miss_penalty is the
+// memory latency behind the whole hierarchy)
+struct CacheConfig
+{
+    int lines;          // Number of cache lines (power of two, 1..MAX_CACHE_LINES)
+    int hit_cycles;     // Cycles for cache hit
+    int miss_penalty;   // Cycles for cache miss (block fill from memory)
+    int ways;           // Associativity (power of two, 1..lines; lines = fully associative)
+    int block_size;     // Bytes per line (power of two, lines * block_size <= MAX_CACHE_BYTES)
+    ReplacementPolicy replacement;
+    WritePolicy write_policy;
+    int write_buffer;   // Coalescing write buffer entries (0..MAX_WRITE_BUFFER)
+    int mshrs;          // Outstanding misses (0..MAX_MSHRS, 0 = blocking)
+    PrefetchPolicy prefetcher;
+    int victim_lines;   // Victim cache lines (0..MAX_VICTIM_LINES)
+    int victim_swap_cycles;
+};
+
+// Cache Line Structure (tag and replacement state; data lives in Cache::data)
 struct CacheLine
 {
     bool valid;         // Valid bit
+    bool dirty;         // Modified since fill (WRITE_BACK)
     uint8_t tag;        // Tag bits
-    uint8_t data;       // Data (1 byte)
+    uint8_t rrpv;       // Re-reference prediction value (SRRIP/BRRIP)
+    bool prefetched;    // Filled by a prefetch, not yet used by a demand access
+    uint64_t prefetch_ready;    // Cycle the prefetch fill's data is usable
+    uint64_t last_use;  // Access stamp (LRU)
+};
+
+// Coalescing write buffer between a cache and memory. Each entry is one
+// pending block write; a store to a block that is already pending merges
+// into its entry. Entries drain in order, one memory write (miss_penalty
+// cycles) at a time, while the pipeline keeps running.
+struct WriteBuffer
+{
+    int count;
+    uint8_t block[MAX_WRITE_BUFFER];    // Block address, oldest first
+    uint64_t done[MAX_WRITE_BUFFER];    // Cycle the write completes
+};
+
+// Miss status holding registers of a non-blocking cache. Each entry is
+// one outstanding block fill; an access to a block that is already
+// outstanding merges into its entry. The block itself is filled when the
+// miss is issued, the entry only carries the timing.
+struct MSHRFile
+{
+    int count;
+    uint8_t block[MAX_MSHRS];           // Block address, in issue order
+    uint64_t ready[MAX_MSHRS];          // Cycle the fill's data is usable
+};
+
+// One cache: geometry derived from its config, lines, block data and
+// replacement state. Line (set, way) is line[set * ways + way].
+struct Cache
+{
+    CacheConfig config;
+    int sets;
+    int offset_bits;                    // log2(block_size)
+    int index_bits;                     // log2(sets)
+    CacheLine line[MAX_CACHE_LINES];
+    uint8_t data[MAX_CACHE_BYTES];      // Line i's block starts at i * block_size
+    uint8_t plru[MAX_CACHE_LINES];      // Tree bits: set * ways + node, node < ways - 1
+    uint64_t clock;                     // Access counter for LRU stamps
+    uint32_t random_state;              // xorshift32 state (RANDOM, BRRIP)
+    WriteBuffer write_buffer;
+    MSHRFile mshr;
+};
+
+// Victim cache
+// Optional fully associative LRU buffer of victim_lines blocks between
+// the L1 and the level below (ctx.victim_cache). Every block the L1
+// evicts is parked there; an L1 miss that finds its block there swaps it
+// with the L1 line being replaced in victim_swap_cycles, and only blocks
+// pushed out of the victim cache continue down (written back if dirty).
+// Like the lower levels it keeps tags and dirty bits only: the L1 writes
+// a dirty victim's bytes to data memory as it evicts it. Inclusive lower
+// levels back-invalidate it along with the L1.
+
+// Cache hierarchy
+// Up to MAX_CACHE_LEVELS levels: the L1 above (ctx.cache) plus lower
+// levels (L2, L3) described by CacheLevelConfig. Lower levels track tags,
+// dirty bits and replacement only; values live in the L1 and data
+// memory. An access costs the latency of the level that hit (its
+// hit_cycles, or the memory's miss_penalty).
+#define MAX_CACHE_LEVELS 3
+#define LOWER_CACHE_LINES 32        // Defaults for a lower level
+#define LOWER_CACHE_WAYS 4
+#define LOWER_CACHE_HIT_CYCLES 3
+
+// Contents of a lower level relative to the levels above it
+enum InclusionPolicy
+{
+    INCLUSION_NINE,         // Non-inclusive non-exclusive: filled on misses, no back-invalidation
+    INCLUSION_INCLUSIVE,    // Holds every block above it; an eviction back-invalidates them
+    INCLUSION_EXCLUSIVE     // Holds only blocks not above it; filled by victims from above
 };
 
-// Cache array
-extern CacheLine cache[CACHE_LINES];
+// One lower level. cache supplies lines, ways, block_size, replacement
+// and hit_cycles (total latency of a hit here); its other fields are
+// unused. Block sizes may not shrink going down, and an exclusive level
+// uses the same block size as the level above.
+struct CacheLevelConfig
+{
+    CacheConfig cache;
+    InclusionPolicy inclusion;
+};
 
-// Cache performance counters
-extern uint64_t cache_hits;
-extern uint64_t cache_misses;
+// Levels behind the L1: level[0] is L2, level[1] is L3
+struct CacheHierarchyConfig
+{
+    int lower_levels;                               // 0 = L1 only
+    CacheLevelConfig level[MAX_CACHE_LEVELS - 1];
+};
+
+// Per-level counters for a lower level (demand accesses are L1 misses)
+struct CacheLevelStats
+{
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t writebacks;            // Dirty blocks evicted from this level
+    uint64_t back_invalidations;    // Lines invalidated above (inclusive)
+};
 
-// Cache-related stall counter
-extern uint64_t cache_stall_cycles;
+// Instruction cache
+// Optional L1 I-cache on the fetch path (ctx.icache_config, ctx.icache),
+// backed directly by instruction memory. It holds tags only (the
+// pipeline never writes instruction memory) and uses lines, ways,
+// block_size (instructions per line), replacement, hit_cycles and
+// miss_penalty. lines = 0 disables it: fetch is free, as in the
+// original two-stage model.
+#define ICACHE_LINES 0
 
-// Initialize cache (all lines invalid)
-void initialize_cache();
+struct SimulatorContext;
 
-// Cache access function
+// The cache (ctx.cache), its performance counters (cache_hits,
+// cache_misses, cache_writebacks, memory_writes, write_buffer_stalls,
+// write_buffer_coalesced), the lower levels (ctx.lower_cache,
+// ctx.lower_cache_stats) and the cache-related stall counter live in
+// SimulatorContext. Write buffer and MSHR timing use ctx.cycle_count.
+//
+// Non-blocking cache (cache_config.mshrs > 0): a miss takes an MSHR and
+// the access returns at once; only a full MSHR file or a write-back
+// stalls the pipeline. The fill latency is returned as pending cycles,
+// which the pipeline charges to the instructions that read the loaded
+// register (ctx.reg_ready). Counters: mshr_merges, mshr_full_stalls,
+// mshr_peak, miss_latency_cycles and mshr_busy_cycles (their ratio is
+// the memory-level parallelism).
+//
+// Prefetching (cache_config.prefetcher): every demand load trains the
+// prefetcher (prefetcher.h); the blocks it names are filled in the
+// background and count as prefetch_issued. The first demand access to
+// such a line counts as prefetch_useful, or prefetch_late if the fill
+// is still in flight (the access then waits for it).
+//
+// Miss classification (3C): a tag-only fully associative LRU shadow of
+// the L1 (ctx.shadow_cache, same lines and block size) and a first-touch
+// bitmap see every demand access. A miss is compulsory on the block's
+// first touch, capacity if the shadow missed as well, and conflict
+// otherwise (compulsory_misses, capacity_misses, conflict_misses).
+// Accesses merged into an outstanding miss are not classified. Per-set
+// counters (set_accesses, set_misses, set_conflicts) feed the heatmap.
+//
+// Victim cache lookups made by L1 misses count as victim_hits or
+// victim_misses; cache_writebacks then counts dirty blocks leaving the
+// victim cache rather than the L1.
+
+// Initialize ctx.cache from ctx.cache_config, the lower levels from
+// ctx.hierarchy_config and the I-cache from ctx.icache_config (all lines
+// invalid)
+void initialize_cache(SimulatorContext &ctx);
+
+// Cache access function (a load by the instruction at pc)
 // Returns: data at address
 // Sets: hit_flag to true if hit, false if miss
-// Sets: stall_cycles to number of stall cycles needed (0 for hit, MISS_PENALTY-1 for miss)
-uint8_t cache_read(uint8_t address, bool &hit_flag, int &stall_cycles);
+// Sets: stall_cycles to number of stall cycles needed (HIT_CYCLES-1 for hit, or until a late
+//       prefetch's fill completes; for a miss, the
+//       latency of the level that had the block (MISS_PENALTY for memory) - 1, plus writing back
+//       a dirty victim: the receiving level's hit_cycles, MISS_PENALTY for memory, or only a
+//       full write buffer's wait)
+// Sets: pending_cycles to 0. Non-blocking cache: stall_cycles only covers waiting for a free
+//       MSHR and write-backs; the hit or fill latency - 1 is in pending_cycles instead (a load
+//       merged into an outstanding miss waits for that fill).
+// Trace: QuietTrace or VerboseTrace (trace_policy.h)
+template <class Trace>
+uint8_t cache_read(SimulatorContext &ctx, uint8_t pc, uint8_t address, bool &hit_flag, int &stall_cycles,
+                   int &pending_cycles);
 
-// Cache write function (write-through policy)
+// Cache write function
+// WRITE_THROUGH: memory is written on every store; without a write buffer
+// a miss allocates the block, with one the store goes to the buffer
+// (no allocate) and retires unless the buffer is full.
+// WRITE_BACK: the block is allocated on a miss and marked dirty.
+// Non-blocking cache: an allocating miss takes an MSHR and stores never
+// wait for the hit or fill latency.
 // Returns: stall cycles needed
-int cache_write(uint8_t address, uint8_t data);
+template <class Trace>
+int cache_write(SimulatorContext &ctx, uint8_t address, uint8_t data);
+
+// I-cache access for the fetch of pc (counted in icache_hits,
+// icache_misses, icache_stall_cycles)
+// Returns: stall cycles before the instruction is available (HIT_CYCLES-1 or MISS_PENALTY-1)
+template <class Trace>
+int icache_fetch(SimulatorContext &ctx, uint8_t pc, bool &hit_flag);
 
 // Display cache contents
-void display_cache();
+void display_cache(SimulatorContext &ctx);
 
 // Display cache statistics
-void display_cache_stats();
+void display_cache_stats(SimulatorContext &ctx);
+
+// Write the per-set counters as CSV (set, accesses, misses,
+// conflict_misses, miss_rate), one row per L1 set; false if path cannot
+// be opened
+bool write_set_heatmap(const SimulatorContext &ctx, const string &path);
 
 // Helper functions
-uint8_t get_cache_index(uint8_t address);
-uint8_t get_cache_tag(uint8_t address);
+uint8_t get_cache_index(SimulatorContext &ctx, uint8_t address);
+uint8_t get_cache_tag(SimulatorContext &ctx, uint8_t address);
+
+// Write dirty lines back to data memory without timing or counters, so
+// memory is architecturally current after a WRITE_BACK run
+void sync_cache_to_memory(SimulatorContext &ctx);
+
+// Check lower levels against the L1 config and each other (valid
+// geometry, block sizes never shrink, exclusive levels match the block
+// size above)
+bool is_valid_cache_hierarchy(const CacheConfig &l1, const CacheHierarchyConfig &hierarchy);
+
+// "32 lines, 4-way (8 sets), LRU, inclusive, 3-cycle hit"
+string describe_cache_level(const CacheLevelConfig &level);
+
+// Inclusion names: nine, inclusive, exclusive
+const char *inclusion_policy_name(InclusionPolicy policy);
+bool parse_inclusion_policy(const string &name, InclusionPolicy &policy);
+
+// Check that a configuration can be simulated (lines, ways and
+// block_size are powers of two, ways <= lines, capacity within
+// MAX_CACHE_BYTES, write buffer within MAX_WRITE_BUFFER, MSHRs within
+// MAX_MSHRS, victim cache within MAX_VICTIM_LINES, latencies are at least
+// one cycle)
+bool is_valid_cache_config(const CacheConfig &config);
+
+// "8 lines, direct-mapped" / "8 lines, 2-way (4 sets), 4-byte blocks, LRU,
+// write-back, 4-entry write buffer, 4 MSHRs, stream prefetcher,
+// 4-line victim cache (2-cycle swap)"
+string describe_cache_config(const CacheConfig &config);
+
+// Policy names: lru, plru, random, srrip, brrip
+const char *replacement_policy_name(ReplacementPolicy policy);
+bool parse_replacement_policy(const string &name, ReplacementPolicy &policy);
+
+// Write policy names: wt, wb
+const char *write_policy_name(WritePolicy policy);
+bool parse_write_policy(const string &name, WritePolicy &policy);
+
+// Generic cache operations (any Cache, no counters or timing)
+
+// Set geometry from config and invalidate every line
+void cache_configure(Cache &cache, const CacheConfig &config);
+
+// Set index, tag and block offset of an address
+uint8_t cache_set_index(const Cache &cache, uint8_t address);
+uint8_t cache_tag(const Cache &cache, uint8_t address);
+uint8_t cache_block_offset(const Cache &cache, uint8_t address);
+
+// Line holding address, or -1. A hit updates the replacement state.
+int cache_lookup(Cache &cache, uint8_t address);
+
+// Line holding address, or -1, leaving the replacement state alone
+int cache_probe(const Cache &cache, uint8_t address);
+
+// Choose a victim in address's set, write it back to memory (256 bytes)
+// if dirty, load the new block and return the line. evicted is the
+// victim's block address, or -1 if the line was invalid; evicted_dirty
+// tells whether it was dirty. memory is nullptr for a tag-only level.
+int cache_fill(Cache &cache, uint8_t address, uint8_t *memory, int &evicted, bool &evicted_dirty);
+
+// Invalidate the line holding address, writing it to memory (unless
+// nullptr) if dirty. Returns false if the block was not cached.
+bool cache_invalidate(Cache &cache, uint8_t address, uint8_t *memory, bool &dirty);
 
 #endif // CACHE_H
@@ -0,0 +1,444 @@
+#include <cstdio>
+#include <cstdlib>
+#include <ctype.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "simulator_context.h"
+#include "data_memory.h"
+#include "cache.h"
+#include "memory_trace.h"
+#include "stack_distance.h"
+#include "sweep.h"
+#include "thread_pool.h"
+
+using namespace std;
+
+// Trace-driven cache simulation
+//
+//      cache_replay trace.mem [--lines L] [--ways W] [--block B] [--policy P]
+//                   [--write wt|wb] [--wbuf N] [--prefetch P] [--victim N] [--swap S]
+//                   [--hit H] [--penalty P] [--l2 SPEC [--l3 SPEC]] [-j N] [--format csv|json] [-o file]
+//      cache_replay trace.mem --stack-distance [--block B] [--histogram file]
+//                   [-j N] [--format csv|json] [-o file]
+//
+// Replays a --mem-trace recording through cache_read()/cache_write()
+// for every point of the cache parameter cross product (same value
+// syntax as simulator mode 5), each in front of the same lower levels.
+// No pipeline, registers or
+// instruction memory are modeled; replays run on the work-stealing pool
+// and share one in-memory copy of the trace. Time advances by one cycle
+// per instruction between accesses (the record's gap) plus the stall
+// cycles, which is what paces the write buffer and prefetch fills.
+// Pipeline bubbles are not in the trace, so write buffer stalls and
+// late prefetches are estimates; every other counter matches the full
+// simulation.
+//
+// --stack-distance replaces the sweep with one LRU stack distance pass
+// per block size and set count (stack_distance.h). It writes the misses
+// of every fully associative size (sets = 1) and of every power-of-two
+// set-associative geometry; --histogram also writes the per-set
+// distance histograms the estimates come from.
+
+// Cache statistics for one configuration
+struct CacheReplayResult
+{
+    uint64_t accesses;
+    uint64_t reads;
+    uint64_t writes;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t stall_cycles;      // Cycles beyond one per access
+    uint64_t writebacks;        // Dirty blocks written back
+    uint64_t memory_writes;     // Writes sent to memory
+    uint64_t buffer_stalls;     // Cycles waiting on a full write buffer
+    uint64_t prefetch_issued;
+    uint64_t prefetch_useful;
+    uint64_t prefetch_late;
+    uint64_t compulsory_misses;
+    uint64_t capacity_misses;
+    uint64_t conflict_misses;
+    uint64_t victim_hits;
+};
+
+// Run every access of records through a fresh cache
+static CacheReplayResult replay_trace(const CacheConfig &config, const CacheHierarchyConfig &hierarchy,
+                                      const vector<MemoryTraceRecord> &records)
+{
+    ostream discard(nullptr);
+    SimulatorContext *ctx = new SimulatorContext;
+    ctx->out = &discard;
+    ctx->cache_config = config;
+    ctx->hierarchy_config = hierarchy;
+    initialize_data_memory(*ctx);
+    initialize_cache(*ctx);
+
+    CacheReplayResult result = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        const MemoryTraceRecord &r = records[i];
+        ctx->cycle_count += r.gap;
+        int stall_cycles;
+        if (r.flags & MEMORY_TRACE_WRITE)
+        {
+            // Store data does not affect hits or latency
+            stall_cycles = cache_write<QuietTrace>(*ctx, r.address, 0);
+            result.writes++;
+        }
+        else
+        {
+            bool hit;
+            int pending_cycles;
+            cache_read<QuietTrace>(*ctx, r.pc, r.address, hit, stall_cycles, pending_cycles);
+            result.reads++;
+        }
+        ctx->cycle_count += stall_cycles;
+    }
+
+    result.accesses = records.size();
+    result.hits = ctx->cache_hits;
+    result.misses = ctx->cache_misses;
+    result.stall_cycles = ctx->cache_stall_cycles;
+    result.writebacks = ctx->cache_writebacks;
+    result.memory_writes = ctx->memory_writes;
+    result.buffer_stalls = ctx->write_buffer_stalls;
+    result.prefetch_issued = ctx->prefetch_issued;
+    result.prefetch_useful = ctx->prefetch_useful;
+    result.prefetch_late = ctx->prefetch_late;
+    result.compulsory_misses = ctx->compulsory_misses;
+    result.capacity_misses = ctx->capacity_misses;
+    result.conflict_misses = ctx->conflict_misses;
+    result.victim_hits = ctx->victim_hits;
+    delete ctx;
+    return result;
+}
+
+// Same lines, ways, block size, replacement and write policy with no
+// write buffer, prefetcher or victim cache (latencies may differ).
+// Buffered and prefetching configs never match: their stalls depend on
+// timing, and victim hits do not cost the miss penalty.
+static bool same_organization(const CacheConfig &a, const CacheConfig &b)
+{
+    return a.lines == b.lines && a.ways == b.ways && a.block_size == b.block_size &&
+           a.replacement == b.replacement && a.write_policy == b.write_policy &&
+           a.write_buffer == 0 && b.write_buffer == 0 &&
+           a.prefetcher == PREFETCH_NONE && b.prefetcher == PREFETCH_NONE &&
+           a.victim_lines == 0 && b.victim_lines == 0;
+}
+
+// Write the miss count of every associativity profile supports
+static void write_stack_distance_rows(SweepFormat format, const StackDistanceProfile &profile, ostream &out)
+{
+    int blocks = 256 / profile.block_size;
+    int max_ways = blocks / profile.sets;
+    for (int ways = 1; ways <= max_ways; ways = (profile.sets == 1) ? ways + 1 : ways * 2)
+    {
+        uint64_t misses = stack_distance_misses(profile, ways);
+        char ratio[32];
+        snprintf(ratio, sizeof(ratio), "%.4f", profile.accesses ? (double)misses / profile.accesses : 0.0);
+
+        if (format == SWEEP_CSV)
+            out << profile.block_size << ',' << profile.sets << ',' << ways << ','
+                << profile.sets * ways << ',' << profile.accesses << ',' << misses << ',' << ratio << '\n';
+        else
+            out << "{\"block_size\":" << profile.block_size
+                << ",\"sets\":" << profile.sets
+                << ",\"ways\":" << ways
+                << ",\"lines\":" << profile.sets * ways
+                << ",\"accesses\":" << profile.accesses
+                << ",\"misses\":" << misses
+                << ",\"miss_ratio\":" << ratio << "}\n";
+    }
+}
+
+// Stack distance analysis of records for each block size
+static int run_stack_distance(const vector<MemoryTraceRecord> &records, const vector<int> &block_sizes,
+                              unsigned int jobs, SweepFormat format, ostream &out, const string &histogram_path)
+{
+    vector<StackDistanceProfile> profiles;
+    for (size_t k = 0; k < block_sizes.size(); k++)
+    {
+        int block_size = block_sizes[k];
+        if (block_size < 1 || block_size > 256 || (block_size & (block_size - 1)) != 0)
+        {
+            cerr << "Invalid block size: " << block_size << endl;
+            return 1;
+        }
+        for (int sets = 1; sets <= 256 / block_size; sets *= 2)
+        {
+            StackDistanceProfile profile;
+            profile.block_size = block_size;
+            profile.sets = sets;
+            profiles.push_back(profile);
+        }
+    }
+
+    {
+        ThreadPool pool(jobs);
+        for (size_t i = 0; i < profiles.size(); i++)
+        {
+            pool.submit([&records, &profiles, i]() {
+                compute_stack_distances(records, profiles[i].block_size, profiles[i].sets, profiles[i]);
+            });
+        }
+        pool.wait_all();
+    }
+
+    if (format == SWEEP_CSV)
+        out << "block_size,sets,ways,lines,accesses,misses,miss_ratio\n";
+    for (size_t i = 0; i < profiles.size(); i++)
+        write_stack_distance_rows(format, profiles[i], out);
+
+    if (!histogram_path.empty())
+    {
+        ofstream file(histogram_path.c_str());
+        if (!file.is_open())
+        {
+            cerr << "Error: Could not open " << histogram_path << endl;
+            return 1;
+        }
+
+        // Finite distances only; first touches are the profile's cold misses
+        file << "block_size,sets,set,distance,count\n";
+        for (size_t i = 0; i < profiles.size(); i++)
+        {
+            const StackDistanceProfile &p = profiles[i];
+            for (int s = 0; s < p.sets; s++)
+                for (size_t d = 0; d < p.histogram[s].size(); d++)
+                    if (p.histogram[s][d] > 0)
+                        file << p.block_size << ',' << p.sets << ',' << s << ',' << d << ','
+                             << p.histogram[s][d] << '\n';
+        }
+    }
+    return 0;
+}
+
+// Write the header row (CSV only)
+static void write_replay_header(SweepFormat format, ostream &out)
+{
+    if (format == SWEEP_CSV)
+        out << "lines,ways,block_size,replacement,write_policy,write_buffer,prefetcher,victim_lines,victim_swap,"
+               "hit_cycles,miss_penalty,"
+               "accesses,reads,writes,hits,misses,hit_rate,stall_cycles,amat,"
+               "writebacks,memory_writes,write_buffer_stalls,prefetch_issued,prefetch_useful,prefetch_late,"
+               "compulsory_misses,capacity_misses,conflict_misses,victim_hits\n";
+}
+
+// Write one row for a finished configuration
+static void write_replay_row(SweepFormat format, const CacheConfig &c, const CacheReplayResult &r, ostream &out)
+{
+    char hit_rate[32], amat[32];
+    snprintf(hit_rate, sizeof(hit_rate), "%.4f", r.accesses ? (double)r.hits / r.accesses : 0.0);
+    snprintf(amat, sizeof(amat), "%.4f", r.accesses ? (double)(r.accesses + r.stall_cycles) / r.accesses : 0.0);
+
+    if (format == SWEEP_CSV)
+    {
+        out << c.lines << ',' << c.ways << ',' << c.block_size << ','
+            << replacement_policy_name(c.replacement) << ','
+            << write_policy_name(c.write_policy) << ',' << c.write_buffer << ','
+            << prefetch_policy_name(c.prefetcher) << ','
+            << c.victim_lines << ',' << c.victim_swap_cycles << ','
+            << c.hit_cycles << ',' << c.miss_penalty << ','
+            << r.accesses << ',' << r.reads << ',' << r.writes << ','
+            << r.hits << ',' << r.misses << ',' << hit_rate << ','
+            << r.stall_cycles << ',' << amat << ','
+            << r.writebacks << ',' << r.memory_writes << ',' << r.buffer_stalls << ','
+            << r.prefetch_issued << ',' << r.prefetch_useful << ',' << r.prefetch_late << ','
+            << r.compulsory_misses << ',' << r.capacity_misses << ',' << r.conflict_misses << ','
+            << r.victim_hits << '\n';
+    }
+    else
+    {
+        out << "{\"lines\":" << c.lines
+            << ",\"ways\":" << c.ways
+            << ",\"block_size\":" << c.block_size
+            << ",\"replacement\":\"" << replacement_policy_name(c.replacement) << '"'
+            << ",\"write_policy\":\"" << write_policy_name(c.write_policy) << '"'
+            << ",\"write_buffer\":" << c.write_buffer
+            << ",\"prefetcher\":\"" << prefetch_policy_name(c.prefetcher) << '"'
+            << ",\"victim_lines\":" << c.victim_lines
+            << ",\"victim_swap\":" << c.victim_swap_cycles
+            << ",\"hit_cycles\":" << c.hit_cycles
+            << ",\"miss_penalty\":" << c.miss_penalty
+            << ",\"accesses\":" << r.accesses
+            << ",\"reads\":" << r.reads
+            << ",\"writes\":" << r.writes
+            << ",\"hits\":" << r.hits
+            << ",\"misses\":" << r.misses
+            << ",\"hit_rate\":" << hit_rate
+            << ",\"stall_cycles\":" << r.stall_cycles
+            << ",\"amat\":" << amat
+            << ",\"writebacks\":" << r.writebacks
+            << ",\"memory_writes\":" << r.memory_writes
+            << ",\"write_buffer_stalls\":" << r.buffer_stalls
+            << ",\"prefetch_issued\":" << r.prefetch_issued
+            << ",\"prefetch_useful\":" << r.prefetch_useful
+            << ",\"prefetch_late\":" << r.prefetch_late
+            << ",\"compulsory_misses\":" << r.compulsory_misses
+            << ",\"capacity_misses\":" << r.capacity_misses
+            << ",\"conflict_misses\":" << r.conflict_misses
+            << ",\"victim_hits\":" << r.victim_hits << "}\n";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    string trace_path = "";
+    string out_path = "";
+    string histogram_path = "";
+    bool stack_distance = false;
+    SweepSpec spec = default_sweep_spec();
+    SweepFormat format = SWEEP_CSV;
+    unsigned int jobs = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string opt = argv[i];
+        bool has_value = (i + 1 < argc);
+        bool ok = true;
+
+        if (opt == "--lines" && has_value)
+            ok = parse_sweep_values(argv[++i], true, spec.lines);
+        else if (opt == "--ways" && has_value)
+            ok = parse_sweep_values(argv[++i], true, spec.ways);
+        else if (opt == "--block" && has_value)
+            ok = parse_sweep_values(argv[++i], true, spec.block_size);
+        else if (opt == "--policy" && has_value)
+            ok = parse_replacement_values(argv[++i], spec.replacement);
+        else if (opt == "--write" && has_value)
+            ok = parse_write_policy_values(argv[++i], spec.write_policy);
+        else if (opt == "--wbuf" && has_value)
+            ok = parse_sweep_values(argv[++i], false, spec.write_buffer);
+        else if (opt == "--prefetch" && has_value)
+            ok = parse_prefetch_values(argv[++i], spec.prefetcher);
+        else if (opt == "--victim" && has_value)
+            ok = parse_sweep_values(argv[++i], false, spec.victim_lines);
+        else if (opt == "--swap" && has_value)
+            ok = parse_sweep_values(argv[++i], false, spec.victim_swap_cycles);
+        else if (opt == "--l2" && has_value)
+        {
+            ok = parse_cache_level(argv[++i], spec.hierarchy.level[0]);
+            if (spec.hierarchy.lower_levels < 1)
+                spec.hierarchy.lower_levels = 1;
+        }
+        else if (opt == "--l3" && has_value && spec.hierarchy.lower_levels >= 1)
+        {
+            ok = parse_cache_level(argv[++i], spec.hierarchy.level[1]);
+            spec.hierarchy.lower_levels = 2;
+        }
+        else if (opt == "--hit" && has_value)
+            ok = parse_sweep_values(argv[++i], false, spec.hit_cycles);
+        else if (opt == "--penalty" && has_value)
+            ok = parse_sweep_values(argv[++i], false, spec.miss_penalty);
+        else if (opt == "-j" && has_value && isdigit((unsigned char)argv[i + 1][0]))
+            jobs = atoi(argv[++i]);
+        else if (opt == "--format" && has_value)
+        {
+            string fmt = argv[++i];
+            ok = (fmt == "csv" || fmt == "json");
+            format = (fmt == "json") ? SWEEP_JSON : SWEEP_CSV;
+        }
+        else if (opt == "-o" && has_value)
+            out_path = argv[++i];
+        else if (opt == "--stack-distance")
+            stack_distance = true;
+        else if (opt == "--histogram" && has_value)
+            histogram_path = argv[++i];
+        else if (trace_path.empty() && opt[0] != '-')
+            trace_path = opt;
+        else
+            ok = false;
+
+        if (!ok)
+        {
+            cerr << "Invalid option or value: " << opt << endl;
+            return 1;
+        }
+    }
+
+    if (trace_path.empty())
+    {
+        cerr << "Usage: cache_replay trace.mem [--lines L] [--ways W] [--block B] [--policy P]"
+                " [--write wt|wb] [--wbuf N] [--prefetch P] [--victim N] [--swap S] [--hit H] [--penalty P]"
+                " [--l2 SPEC [--l3 SPEC]]"
+                " [-j N] [--format csv|json] [-o file]" << endl;
+        cerr << "       cache_replay trace.mem --stack-distance [--block B] [--histogram file]"
+                " [-j N] [--format csv|json] [-o file]" << endl;
+        return 1;
+    }
+
+    vector<MemoryTraceRecord> records;
+    if (!load_memory_trace(trace_path, records))
+        return 1;
+
+    ofstream file;
+    if (!out_path.empty())
+    {
+        file.open(out_path.c_str());
+        if (!file.is_open())
+        {
+            cerr << "Error: Could not open " << out_path << endl;
+            return 1;
+        }
+    }
+    ostream &out = file.is_open() ? (ostream &)file : cout;
+
+    if (stack_distance)
+        return run_stack_distance(records, spec.block_size, jobs, format, out, histogram_path);
+
+    vector<CacheConfig> configs;
+    size_t skipped;
+    if (!expand_cache_configs(spec, configs, skipped))
+        return 1;
+    if (skipped > 0)
+        cerr << "Warning: skipped " << skipped << " cache configurations whose geometry cannot exist" << endl;
+
+    // Without a write buffer or lower levels, hits, misses and
+    // write-backs depend only on the organization; latencies only scale
+    // the stall cycles (cache.cpp charges hit_cycles - 1 per hit,
+    // miss_penalty - 1 per miss and miss_penalty per write-back). Replay
+    // each distinct organization once and derive the other latency
+    // points from its counts.
+    vector<size_t> replayed(configs.size());
+    vector<size_t> unique;
+    for (size_t i = 0; i < configs.size(); i++)
+    {
+        size_t u = 0;
+        while (u < unique.size() &&
+               (spec.hierarchy.lower_levels > 0 || !same_organization(configs[unique[u]], configs[i])))
+            u++;
+        if (u == unique.size())
+            unique.push_back(i);
+        replayed[i] = unique[u];
+    }
+
+    vector<CacheReplayResult> results(configs.size());
+    {
+        ThreadPool pool(jobs);
+        for (size_t u = 0; u < unique.size(); u++)
+        {
+            size_t i = unique[u];
+            pool.submit([&configs, &spec, &results, &records, i]() {
+                results[i] = replay_trace(configs[i], spec.hierarchy, records);
+            });
+        }
+        pool.wait_all();
+    }
+
+    for (size_t i = 0; i < configs.size(); i++)
+    {
+        CacheReplayResult &r = results[i];
+        if (replayed[i] == i)
+            continue;
+        r = results[replayed[i]];
+        r.stall_cycles = r.hits * (configs[i].hit_cycles - 1) + r.misses * (configs[i].miss_penalty - 1) +
+                         r.writebacks * configs[i].miss_penalty;
+    }
+
+    write_replay_header(format, out);
+    for (size_t i = 0; i < configs.size(); i++)
+        write_replay_row(format, configs[i], results[i], out);
+
+    return 0;
+}
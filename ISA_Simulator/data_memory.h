@@ -3,19 +3,20 @@
 
 #include <cstdint>
 
-// Data Memory: 256 locations × 8-bit each
-extern uint8_t data_memory[256];
+struct SimulatorContext;
+
+// Data Memory: 256 locations × 8-bit each (stored in SimulatorContext)
 
 // Initialize data memory (clear to 0)
-void initialize_data_memory();
+void initialize_data_memory(SimulatorContext &ctx);
 
 // Read 8-bit value from data memory
-uint8_t read_data_memory(uint8_t address);
+uint8_t read_data_memory(SimulatorContext &ctx, uint8_t address);
 
 // Write 8-bit value to data memory
-void write_data_memory(uint8_t address, uint8_t value);
+void write_data_memory(SimulatorContext &ctx, uint8_t address, uint8_t value);
 
 // Display data memory contents for debugging
-void display_data_memory(uint8_t start_address = 0, uint8_t end_address = 255);
+void display_data_memory(SimulatorContext &ctx, uint8_t start_address = 0, uint8_t end_address = 255);
 
 #endif // DATA_MEMORY_H
@@ -0,0 +1,91 @@
+#include "functional.h"
+#include "simulator_context.h"
+#include "pipeline.h"
+
+using namespace std;
+
+// Execute the instruction at ctx.PC and advance PC
+const DecodedInstruction &functional_step(SimulatorContext &ctx)
+{
+    const DecodedInstruction &inst = ctx.decoded_program[ctx.PC];
+    uint8_t reg = inst.operand;
+    uint8_t data = inst.address_data;
+    uint8_t *regs = ctx.register_file;
+    uint8_t next_pc = ctx.PC + 1;
+    
+    switch (inst.opcode)
+    {
+        case 0x01: // ADD
+            regs[reg] = regs[reg] + regs[(reg + 1) % 16];
+            break;
+        case 0x02: // SUB
+            regs[reg] = regs[reg] - regs[(reg + 1) % 16];
+            break;
+        case 0x03: // MUL
+            regs[reg] = regs[reg] * regs[(reg + 1) % 16];
+            break;
+        case 0x04: // DIV
+            if (regs[(reg + 1) % 16] != 0)
+                regs[reg] = regs[reg] / regs[(reg + 1) % 16];
+            break;
+        case 0x0D: // LD
+            ctx.MAR = data;
+            ctx.MDR = ctx.data_memory[data];
+            regs[reg] = ctx.MDR;
+            break;
+        case 0x0E: // ST
+            ctx.MAR = data;
+            ctx.MDR = regs[reg];
+            ctx.data_memory[data] = ctx.MDR;
+            break;
+        case 0x08: // JMP
+        case 0x0A: // JMP (alternate opcode)
+            // The pipeline advances PC past the flushed fetch slot,
+            // so execution resumes at target + 1
+            next_pc = data + 1;
+            break;
+        case 0x05: // BEQZ
+            if (regs[reg] == 0)
+                next_pc = data;
+            break;
+        case 0x06: // BNEZ
+            if (regs[reg] != 0)
+                next_pc = data;
+            break;
+        case 0x0F: // HALT
+            ctx.halt_flag = true;
+            break;
+        default:
+            break;
+    }
+    
+    // R0 is hardwired to 0
+    regs[0] = 0;
+    
+    ctx.PC = next_pc;
+    return inst;
+}
+
+// True if spec asks for any fast-forwarding
+bool fast_forward_enabled(const FastForwardSpec &spec)
+{
+    return spec.instructions > 0 || spec.stop_pc >= 0;
+}
+
+// Execute functionally until the spec is met or HALT
+uint64_t fast_forward(SimulatorContext &ctx, const FastForwardSpec &spec)
+{
+    uint64_t limit = spec.instructions > 0 ? spec.instructions : FAST_FORWARD_MAX_INSTRUCTIONS;
+    uint64_t executed = 0;
+    
+    while (!ctx.halt_flag && executed < limit)
+    {
+        if (spec.stop_pc >= 0 && ctx.PC == spec.stop_pc)
+            break;
+        
+        functional_step(ctx);
+        executed++;
+    }
+    
+    return executed;
+}
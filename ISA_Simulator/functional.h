@@ -0,0 +1,39 @@
+#ifndef FUNCTIONAL_H
+#define FUNCTIONAL_H
+
+#include <cstdint>
+
+struct SimulatorContext;
+struct DecodedInstruction;
+
+// Functional Fast-Forward
+// Executes instructions for their architectural effect only (registers,
+// data memory, MAR/MDR, PC, halt) with no pipeline, hazard, cache or
+// cycle modeling. run_simulation() uses it to skip to a region of
+// interest, then continues from the resulting state in the detailed
+// pipeline model.
+
+// Upper bound on a fast-forward that has no instruction limit, so a
+// stop PC that is never reached cannot spin forever
+const uint64_t FAST_FORWARD_MAX_INSTRUCTIONS = 100000000;
+
+// Where to switch from functional to detailed simulation
+struct FastForwardSpec
+{
+    uint64_t instructions;  // Stop after this many instructions (0 = no limit)
+    int stop_pc;            // Stop before executing this address (-1 = none)
+};
+
+// Execute the instruction at ctx.PC and advance PC.
+// Returns the executed instruction.
+const DecodedInstruction &functional_step(SimulatorContext &ctx);
+
+// True if spec asks for any fast-forwarding
+bool fast_forward_enabled(const FastForwardSpec &spec);
+
+// Execute functionally from ctx.PC until the spec is met or HALT.
+// Performance and cache counters are not touched.
+// Returns the number of instructions executed.
+uint64_t fast_forward(SimulatorContext &ctx, const FastForwardSpec &spec);
+
+#endif // FUNCTIONAL_H
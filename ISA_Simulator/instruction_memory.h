@@ -0,0 +1,63 @@
+#ifndef INSTRUCTION_MEMORY_H
+#define INSTRUCTION_MEMORY_H
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+struct SimulatorContext;
+
+/*
+     Packed instruction word (memory.cpp)
+     One 16-bit word per memory slot:
+          [15:12] opcode  [11:8] register operand  [7:0] address / immediate
+     The whole 256-slot image is 512 bytes, so it stays resident in the
+     host's L1 cache. Assembly text lives in a separate side table that is
+     only read for display and logging.
+*/
+typedef uint16_t InstructionWord;
+
+// Build a word from its fields
+inline InstructionWord pack_instruction(uint8_t opcode, uint8_t reg, uint8_t data)
+{
+    return (InstructionWord)(((opcode & 0x0F) << 12) | ((reg & 0x0F) << 8) | data);
+}
+
+// Field accessors
+inline uint8_t instruction_opcode(InstructionWord word) { return (word >> 12) & 0x0F; }
+inline uint8_t instruction_register(InstructionWord word) { return (word >> 8) & 0x0F; }
+inline uint8_t instruction_data(InstructionWord word) { return word & 0xFF; }
+
+// Display/logging side table entry (never read on the per-cycle path)
+struct InstructionText
+{
+    string instruction;   // Instruction text (opcode + operands)
+    string mnemonic;      // Assembly mnemonic (ADD, SUB, MUL, etc.)
+    bool valid;           // Flag indicating if memory location is valid
+};
+
+// Initialize memory with the loaded program (ctx.program), or the
+// sample program and data
+void initialize_memory(SimulatorContext &ctx);
+
+// Read memory at address
+InstructionWord read_memory(SimulatorContext &ctx, unsigned int address);
+
+// Write to memory (keeps the pre-decoded table in sync)
+void write_memory(SimulatorContext &ctx, unsigned int address, InstructionWord word);
+
+// Set the display text for a memory slot
+void write_memory_text(SimulatorContext &ctx, unsigned int address,
+                       const string &instruction, const string &mnemonic);
+
+// Display memory contents
+void display_memory(SimulatorContext &ctx, unsigned int start, unsigned int end);
+
+// Display program section (addresses 0x00 - 0x0F)
+void display_program_section(SimulatorContext &ctx);
+
+// Display data section
+void display_data_section(SimulatorContext &ctx);
+
+#endif // INSTRUCTION_MEMORY_H
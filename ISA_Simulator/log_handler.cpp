@@ -1,148 +1,291 @@
+#include "log_handler.h"
 #include <bits/stdc++.h>
 #include <ctime>
 #include <iomanip>
 
 using namespace std;
 
-void logger1(string user_entry)
+/*
+     Asynchronous logger
+     Callers format their entry and push it into a bounded lock-free ring
+     (multi-producer, single-consumer; one sequence number per slot). A
+     background thread owns log.txt, which stays open for the whole run,
+     adds the timestamps and writes whole batches with one write + flush.
+     When the ring is full the caller either waits for the writer
+     (LOG_OVERFLOW_BLOCK, default) or drops the entry and counts it
+     (LOG_OVERFLOW_DROP), so memory stays bounded at LOG_RING_CAPACITY
+     entries.
+*/
+
+const size_t LOG_RING_CAPACITY = 4096;                      // Entries (power of two)
+const size_t LOG_WAKE_THRESHOLD = LOG_RING_CAPACITY / 4;    // Wake the writer early
+const int LOG_FLUSH_INTERVAL_MS = 20;                       // Writer wakes at least this often
+
+struct LogSlot
 {
-     ofstream logfile("log.txt", ios::app);
+     atomic<size_t> sequence;   // == position: free, == position + 1: filled
+     time_t time;
+     bool blank_line;           // Entry starts with an empty line
+     string text;
+};
 
-     if (!logfile.is_open())
+class AsyncLogger
+{
+public:
+     AsyncLogger()
+          : enqueue_pos(0), dequeue_pos(0), written_pos(0), dropped(0),
+            policy(LOG_OVERFLOW_BLOCK), stopping(false)
      {
-          cerr << "Error: Could not open log file\n";
-          return;
+          for (size_t i = 0; i < LOG_RING_CAPACITY; i++)
+               slots[i].sequence.store(i, memory_order_relaxed);
+          writer = thread(&AsyncLogger::writer_loop, this);
      }
 
-     time_t now = time(0);
-     tm *ltm = localtime(&now);
-
-     logfile << "["
-             << 1900 + ltm->tm_year << "-"
-             << setw(2) << setfill('0') << 1 + ltm->tm_mon << "-"
-             << setw(2) << setfill('0') << ltm->tm_mday << " "
-             << setw(2) << setfill('0') << ltm->tm_hour << ":"
-             << setw(2) << setfill('0') << ltm->tm_min << ":"
-             << setw(2) << setfill('0') << ltm->tm_sec
-             << "] ";
-
-     logfile << user_entry << endl;
+     ~AsyncLogger()
+     {
+          {
+               lock_guard<mutex> lock(wake_mutex);
+               stopping = true;
+          }
+          wake.notify_one();
+          writer.join();
+     }
 
-     logfile.close();
-}
+     // Queue one entry (called from any thread)
+     void push(string &text, bool blank_line)
+     {
+          time_t now = time(0);
+          while (!try_push(text, blank_line, now))
+          {
+               if (policy.load(memory_order_relaxed) == LOG_OVERFLOW_DROP)
+               {
+                    dropped.fetch_add(1, memory_order_relaxed);
+                    return;
+               }
+               wake.notify_one();
+               this_thread::yield();
+          }
 
-// Operation logging function that tracks address, operations, values, and instructions with timestamp
-void log_operation(string operation_type, unsigned int address, string instruction,
-                   vector<bool> input_value = {}, vector<bool> output_value = {},
-                   string additional_info = "")
-{
-     ofstream logfile("log.txt", ios::app);
+          size_t queued = enqueue_pos.load(memory_order_relaxed) - written_pos.load(memory_order_relaxed);
+          if (queued == LOG_WAKE_THRESHOLD)
+               wake.notify_one();
+     }
 
-     if (!logfile.is_open())
+     // Wait until everything queued so far is in log.txt
+     void flush()
      {
-          cerr << "Error: Could not open log file for operation logging\n";
-          return;
+          size_t target = enqueue_pos.load(memory_order_acquire);
+          while (written_pos.load(memory_order_acquire) < target)
+          {
+               wake.notify_one();
+               this_thread::sleep_for(chrono::milliseconds(1));
+          }
      }
 
-     time_t now = time(0);
-     tm *ltm = localtime(&now);
+     void set_policy(LogOverflowPolicy new_policy)
+     {
+          policy.store(new_policy, memory_order_relaxed);
+     }
 
-     // Format: [YYYY-MM-DD HH:MM:SS]
-     logfile << "\n[" << 1900 + ltm->tm_year << "-"
-             << setw(2) << setfill('0') << 1 + ltm->tm_mon << "-"
-             << setw(2) << setfill('0') << ltm->tm_mday << " "
-             << setw(2) << setfill('0') << ltm->tm_hour << ":"
-             << setw(2) << setfill('0') << ltm->tm_min << ":"
-             << setw(2) << setfill('0') << ltm->tm_sec << "] ";
+private:
+     LogSlot slots[LOG_RING_CAPACITY];
+     atomic<size_t> enqueue_pos;     // Next position for producers
+     size_t dequeue_pos;             // Next position for the writer (writer thread only)
+     atomic<size_t> written_pos;     // Positions below this are in the file
+     atomic<uint64_t> dropped;       // Entries dropped under LOG_OVERFLOW_DROP
+     atomic<int> policy;
 
-     // Operation Type
-     logfile << "OPERATION: " << operation_type << " | ";
+     thread writer;
+     mutex wake_mutex;
+     condition_variable wake;
+     bool stopping;
 
-     // Address
-     logfile << "ADDRESS: 0x" << hex << setw(4) << setfill('0') << address << " | ";
+     // Claim a slot with CAS on enqueue_pos; false if the ring is full
+     bool try_push(string &text, bool blank_line, time_t now)
+     {
+          size_t pos = enqueue_pos.load(memory_order_relaxed);
+          LogSlot *slot;
+          for (;;)
+          {
+               slot = &slots[pos & (LOG_RING_CAPACITY - 1)];
+               size_t seq = slot->sequence.load(memory_order_acquire);
+               intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+               if (diff == 0)
+               {
+                    if (enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                         break;
+               }
+               else if (diff < 0)
+                    return false;
+               else
+                    pos = enqueue_pos.load(memory_order_relaxed);
+          }
 
-     // Instruction
-     logfile << "INSTRUCTION: " << instruction << " | ";
+          slot->time = now;
+          slot->blank_line = blank_line;
+          slot->text.swap(text);
+          slot->sequence.store(pos + 1, memory_order_release);
+          return true;
+     }
 
-     // Input Value
-     if (!input_value.empty())
+     // Append "[YYYY-MM-DD HH:MM:SS] " for t, reformatting only when the second changes
+     void append_timestamp(string &batch, time_t t, time_t &cached_time, char *cached_stamp)
      {
-          logfile << "INPUT: ";
-          for (bool bit : input_value)
-               logfile << (bit ? "1" : "0");
-          logfile << " | ";
+          if (t != cached_time)
+          {
+               tm *ltm = localtime(&t);  // Writer thread is the only caller
+               snprintf(cached_stamp, 64, "[%04d-%02d-%02d %02d:%02d:%02d] ",
+                        1900 + ltm->tm_year, 1 + ltm->tm_mon, ltm->tm_mday,
+                        ltm->tm_hour, ltm->tm_min, ltm->tm_sec);
+               cached_time = t;
+          }
+          batch += cached_stamp;
      }
 
-     // Output Value
-     if (!output_value.empty())
+     // Move up to one ring's worth of filled slots into batch; returns the number taken
+     size_t drain(string &batch, time_t &cached_time, char *cached_stamp)
      {
-          logfile << "OUTPUT: ";
-          for (bool bit : output_value)
-               logfile << (bit ? "1" : "0");
-          logfile << " | ";
+          size_t taken = 0;
+          while (taken < LOG_RING_CAPACITY)
+          {
+               LogSlot &slot = slots[dequeue_pos & (LOG_RING_CAPACITY - 1)];
+               if (slot.sequence.load(memory_order_acquire) != dequeue_pos + 1)
+                    break;
+
+               if (slot.blank_line)
+                    batch += '\n';
+               append_timestamp(batch, slot.time, cached_time, cached_stamp);
+               batch += slot.text;
+               batch += '\n';
+               slot.text.clear();
+
+               slot.sequence.store(dequeue_pos + LOG_RING_CAPACITY, memory_order_release);
+               dequeue_pos++;
+               taken++;
+          }
+          return taken;
      }
 
-     // Additional Information
-     if (!additional_info.empty())
+     void writer_loop()
      {
-          logfile << "INFO: " << additional_info << " | ";
+          ofstream logfile("log.txt", ios::app);
+          if (!logfile.is_open())
+               cerr << "Error: Could not open log file\n";
+
+          string batch;
+          time_t cached_time = (time_t)-1;
+          char cached_stamp[64];
+          uint64_t reported_drops = 0;
+
+          for (;;)
+          {
+               bool stop;
+               {
+                    unique_lock<mutex> lock(wake_mutex);
+                    if (!stopping)
+                         wake.wait_for(lock, chrono::milliseconds(LOG_FLUSH_INTERVAL_MS));
+                    stop = stopping;
+               }
+
+               batch.clear();
+               size_t taken = drain(batch, cached_time, cached_stamp);
+
+               uint64_t drops = dropped.load(memory_order_relaxed);
+               if (drops != reported_drops)
+               {
+                    append_timestamp(batch, time(0), cached_time, cached_stamp);
+                    batch += "LOGGER: " + to_string(drops - reported_drops) +
+                             " entries dropped (ring buffer full)\n";
+                    reported_drops = drops;
+               }
+
+               if (!batch.empty() && logfile.is_open())
+               {
+                    logfile.write(batch.data(), batch.size());
+                    logfile.flush();
+               }
+               written_pos.fetch_add(taken, memory_order_release);
+
+               // Producers have stopped by the time the logger is destroyed,
+               // so an empty drain after stopping means everything is written
+               if (stop && taken == 0 && drops == reported_drops)
+                    break;
+          }
      }
+};
 
-     logfile << dec << endl;
-     logfile.close();
+// The logger starts on first use and drains on normal exit
+static AsyncLogger &async_logger()
+{
+     static AsyncLogger logger;
+     return logger;
 }
 
-// Simplified operation logging with commonly used parameters
-void log_alu_operation(string operation_name, unsigned int address, string instruction,
-                       vector<bool> input1 = {}, vector<bool> input2 = {},
-                       vector<bool> result = {})
+void logger1(string user_entry)
 {
-     ofstream logfile("log.txt", ios::app);
+     async_logger().push(user_entry, false);
+}
 
-     if (!logfile.is_open())
-     {
-          cerr << "Error: Could not open log file for ALU operation logging\n";
+// Append a bit vector as "NAME: 0101 | "
+static void append_bits(string &entry, const char *name, const vector<bool> &bits)
+{
+     if (bits.empty())
           return;
-     }
 
-     time_t now = time(0);
-     tm *ltm = localtime(&now);
+     entry += name;
+     entry += ": ";
+     for (bool bit : bits)
+          entry += (bit ? '1' : '0');
+     entry += " | ";
+}
 
-     logfile << "\n[" << 1900 + ltm->tm_year << "-"
-             << setw(2) << setfill('0') << 1 + ltm->tm_mon << "-"
-             << setw(2) << setfill('0') << ltm->tm_mday << " "
-             << setw(2) << setfill('0') << ltm->tm_hour << ":"
-             << setw(2) << setfill('0') << ltm->tm_min << ":"
-             << setw(2) << setfill('0') << ltm->tm_sec << "] ";
+// Operation logging function that tracks address, operations, values, and instructions with timestamp
+void log_operation(string operation_type, unsigned int address, string instruction,
+                   vector<bool> input_value, vector<bool> output_value,
+                   string additional_info)
+{
+     char addr[16];
+     snprintf(addr, sizeof(addr), "0x%04x", address);
 
-     logfile << "ALU_OP: " << operation_name << " | ";
-     logfile << "ADDR: 0x" << hex << setw(4) << setfill('0') << address << dec << " | ";
-     logfile << "INST: " << instruction << " | ";
+     string entry = "OPERATION: " + operation_type + " | ";
+     entry += "ADDRESS: " + string(addr) + " | ";
+     entry += "INSTRUCTION: " + instruction + " | ";
+     append_bits(entry, "INPUT", input_value);
+     append_bits(entry, "OUTPUT", output_value);
 
-     if (!input1.empty())
-     {
-          logfile << "VAL1: ";
-          for (bool bit : input1)
-               logfile << (bit ? "1" : "0");
-          logfile << " | ";
-     }
+     // Additional Information
+     if (!additional_info.empty())
+          entry += "INFO: " + additional_info + " | ";
 
-     if (!input2.empty())
-     {
-          logfile << "VAL2: ";
-          for (bool bit : input2)
-               logfile << (bit ? "1" : "0");
-          logfile << " | ";
-     }
+     async_logger().push(entry, true);
+}
 
-     if (!result.empty())
-     {
-          logfile << "RESULT: ";
-          for (bool bit : result)
-               logfile << (bit ? "1" : "0");
-          logfile << " | ";
-     }
+// Simplified operation logging with commonly used parameters
+void log_alu_operation(string operation_name, unsigned int address, string instruction,
+                       vector<bool> input1, vector<bool> input2,
+                       vector<bool> result)
+{
+     char addr[16];
+     snprintf(addr, sizeof(addr), "0x%04x", address);
 
-     logfile << endl;
-     logfile.close();
+     string entry = "ALU_OP: " + operation_name + " | ";
+     entry += "ADDR: " + string(addr) + " | ";
+     entry += "INST: " + instruction + " | ";
+     append_bits(entry, "VAL1", input1);
+     append_bits(entry, "VAL2", input2);
+     append_bits(entry, "RESULT", result);
+
+     async_logger().push(entry, true);
+}
+
+// Block until every entry logged so far has been written to log.txt
+void flush_log()
+{
+     async_logger().flush();
+}
+
+// Choose what a full ring buffer does to the caller
+void set_log_overflow_policy(LogOverflowPolicy policy)
+{
+     async_logger().set_policy(policy);
 }
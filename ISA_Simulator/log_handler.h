@@ -4,6 +4,16 @@
 #include <string>
 #include <vector>
 
+// All logging calls queue their entry in a bounded in-memory ring and
+// return; a background thread appends to log.txt in batches.
+
+// What a logging call does when the ring buffer is full
+enum LogOverflowPolicy
+{
+    LOG_OVERFLOW_BLOCK,     // Wait for the writer thread (no entries lost)
+    LOG_OVERFLOW_DROP       // Discard the entry; the drop count is logged
+};
+
 // Simple logging function
 void logger1(std::string user_entry);
 
@@ -17,4 +27,10 @@ void log_alu_operation(std::string operation_name, unsigned int address, std::st
                        std::vector<bool> input1 = {}, std::vector<bool> input2 = {},
                        std::vector<bool> result = {});
 
+// Block until every entry logged so far has been written to log.txt
+void flush_log();
+
+// Choose what a full ring buffer does to the caller (default: block)
+void set_log_overflow_policy(LogOverflowPolicy policy);
+
 #endif // LOG_HANDLER_H
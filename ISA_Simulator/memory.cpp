@@ -1,95 +1,118 @@
+#include "instruction_memory.h"
+#include "simulator_context.h"
+#include "program_loader.h"
 #include <bits/stdc++.h>
 using namespace std;
 
 
 /*
-     Structure of memory.h
-     Uint Addr , Instruction , Operand , opcode, data, valid
-     certain memory locations are reserved for instructions and hence addressing 
-     would start from 0X80 to 0xFF.
+     Instruction memory: 256 packed InstructionWords
+     [opcode:4 | register:4 | address/immediate:8] in SimulatorContext::main_memory,
+     with the instruction text, mnemonic and valid flag kept in memory_text.
 */
-struct memoryElement
+
+// Place one slot: packed word plus its display text
+static void place(SimulatorContext &ctx, uint8_t address, const char *instruction,
+                  uint8_t reg, const char *mnemonic, uint8_t opcode, uint8_t data)
 {
-     unsigned int address; // Memory address
-     string instruction;   // Instruction (opcode + operands)
-     bool operand[4];      // 4-bit operand
-     string mnemonic;      // Assembly mnemonic (ADD, SUB, MUL, etc.)
-     unsigned char opcode; // Opcode byte
-     string data;          // Data value
-     bool valid;           // Flag indicating if memory location is valid
-};
-
-// Main memory array - simulating 256 memory locations
-memoryElement main_memory[256];
-
-// Initialize memory with sample program and data
-void initialize_memory()
+     ctx.main_memory[address] = pack_instruction(opcode, reg, data);
+     ctx.memory_text[address].instruction = instruction;
+     ctx.memory_text[address].mnemonic = mnemonic;
+     ctx.memory_text[address].valid = true;
+}
+
+// Initialize memory with the loaded program, or the sample program and data
+void initialize_memory(SimulatorContext &ctx)
 {
+     // Loaded program (program.hex or binary image)
+     if (ctx.program != nullptr)
+     {
+          for (int i = 0; i < 256; i++)
+          {
+               ctx.main_memory[i] = ctx.program->words[i];
+               ctx.memory_text[i] = ctx.program->text[i];
+          }
+          return;
+     }
+
      // Clear memory
      for (int i = 0; i < 256; i++)
      {
-          main_memory[i].address = i;
-          main_memory[i].instruction = "";
-          main_memory[i].mnemonic = "";
-          main_memory[i].opcode = 0;
-          main_memory[i].data = "0x00";
-          main_memory[i].valid = false;
-          for (int j = 0; j < 4; j++)
-               main_memory[i].operand[j] = 0;
+          ctx.main_memory[i] = 0;
+          ctx.memory_text[i].instruction = "";
+          ctx.memory_text[i].mnemonic = "";
+          ctx.memory_text[i].valid = false;
      }
 
 
      // Program section (addresses 0x00 - 0x0F)
      // Test Program: Load-Use Hazard Test (for Assignment IV)
-     main_memory[0x00] = {0x00, "LD R1, 10", {0, 0, 0, 1}, "LD", 0x0D, "0x0A", true};      // Load from address 10
-     main_memory[0x01] = {0x01, "ADD R1", {0, 0, 0, 1}, "ADD", 0x01, "0x00", true};        // Uses R1 - HAZARD!
-     main_memory[0x02] = {0x02, "ST R2, 20", {0, 0, 1, 0}, "ST", 0x0E, "0x14", true};      // Store R2 to address 20
-     main_memory[0x03] = {0x03, "LD R3, 11", {0, 0, 1, 1}, "LD", 0x0D, "0x0B", true};      // Load from address 11
-     main_memory[0x04] = {0x04, "SUB R3", {0, 0, 1, 1}, "SUB", 0x02, "0x00", true};        // Uses R3 - HAZARD!
-     main_memory[0x05] = {0x05, "MUL R1", {0, 0, 0, 1}, "MUL", 0x03, "0x00", true};
-     main_memory[0x06] = {0x06, "ST R1, 21", {0, 0, 0, 1}, "ST", 0x0E, "0x15", true};      // Store R1 to address 21
-     main_memory[0x07] = {0x07, "HALT", {0, 0, 0, 0}, "HLT", 0x0F, "0x00", true};
+     place(ctx, 0x00, "LD R1, 10", 1, "LD", 0x0D, 0x0A);      // Load from address 10
+     place(ctx, 0x01, "ADD R1", 1, "ADD", 0x01, 0x00);        // Uses R1 - HAZARD!
+     place(ctx, 0x02, "ST R2, 20", 2, "ST", 0x0E, 0x14);      // Store R2 to address 20
+     place(ctx, 0x03, "LD R3, 11", 3, "LD", 0x0D, 0x0B);      // Load from address 11
+     place(ctx, 0x04, "SUB R3", 3, "SUB", 0x02, 0x00);        // Uses R3 - HAZARD!
+     place(ctx, 0x05, "MUL R1", 1, "MUL", 0x03, 0x00);
+     place(ctx, 0x06, "ST R1, 21", 1, "ST", 0x0E, 0x15);      // Store R1 to address 21
+     place(ctx, 0x07, "HALT", 0, "HLT", 0x0F, 0x00);
 
      // Additional program instructions
-     main_memory[0x08] = {0x08, "ADD R1", {0, 0, 0, 1}, "ADD", 0x01, "0x00", true};
-     main_memory[0x09] = {0x09, "SUB R3", {0, 0, 1, 1}, "SUB", 0x02, "0x00", true};
-     main_memory[0x0A] = {0x0A, "MUL R1", {0, 0, 0, 1}, "MUL", 0x03, "0x00", true};
-     main_memory[0x0B] = {0x0B, "DIV R2", {0, 0, 1, 0}, "DIV", 0x04, "0x00", true};
-     main_memory[0x0C] = {0x0C, "LD R5, 12", {0, 1, 0, 1}, "LD", 0x0D, "0x0C", true};
-     main_memory[0x0D] = {0x0D, "ST R5, 22", {0, 1, 0, 1}, "ST", 0x0E, "0x16", true};
-     main_memory[0x0E] = {0x0E, "JMP 0x0F", {1, 1, 1, 1}, "JMP", 0x08, "0x0F", true};
-     main_memory[0x0F] = {0x0F, "HALT", {0, 0, 0, 0}, "HLT", 0x0F, "0x00", true};
+     place(ctx, 0x08, "ADD R1", 1, "ADD", 0x01, 0x00);
+     place(ctx, 0x09, "SUB R3", 3, "SUB", 0x02, 0x00);
+     place(ctx, 0x0A, "MUL R1", 1, "MUL", 0x03, 0x00);
+     place(ctx, 0x0B, "DIV R2", 2, "DIV", 0x04, 0x00);
+     place(ctx, 0x0C, "LD R5, 12", 5, "LD", 0x0D, 0x0C);
+     place(ctx, 0x0D, "ST R5, 22", 5, "ST", 0x0E, 0x16);
+     place(ctx, 0x0E, "JMP 0x0F", 15, "JMP", 0x08, 0x0F);
+     place(ctx, 0x0F, "HALT", 0, "HLT", 0x0F, 0x00);
 
      // Data section (addresses 0x0A - 0x15 for data values)
      // These are the values that will be loaded by LD instructions
-     main_memory[0x0A] = {0x0A, "DATA: 0x42", {0, 1, 0, 0}, "DATA", 0x00, "0x42", true}; // 66 in decimal (address 10)
-     main_memory[0x0B] = {0x0B, "DATA: 0x15", {0, 0, 0, 1}, "DATA", 0x00, "0x15", true}; // 21 in decimal (address 11)
-     main_memory[0x0C] = {0x0C, "DATA: 0x78", {0, 1, 1, 1}, "DATA", 0x00, "0x78", true}; // 120 in decimal (address 12)
+     place(ctx, 0x0A, "DATA: 0x42", 4, "DATA", 0x00, 0x42); // 66 in decimal (address 10)
+     place(ctx, 0x0B, "DATA: 0x15", 1, "DATA", 0x00, 0x15); // 21 in decimal (address 11)
+     place(ctx, 0x0C, "DATA: 0x78", 7, "DATA", 0x00, 0x78); // 120 in decimal (address 12)
 }
 
 // Read memory at address
-memoryElement read_memory(unsigned int address)
+InstructionWord read_memory(SimulatorContext &ctx, unsigned int address)
 {
      if (address < 256)
-          return main_memory[address];
+          return ctx.main_memory[address];
      else
      {
           cerr << "Memory access out of bounds: " << address << endl;
-          return main_memory[0];
+          return ctx.main_memory[0];
      }
 }
 
 // Write to memory
-void write_memory(unsigned int address, memoryElement element)
+void write_memory(SimulatorContext &ctx, unsigned int address, InstructionWord word)
 {
      if (address < 256)
-          main_memory[address] = element;
+     {
+          ctx.main_memory[address] = word;
+          predecode_instruction(ctx, (uint8_t)address);  // Keep the decoded table in sync
+     }
+     else
+          cerr << "Memory write out of bounds: " << address << endl;
+}
+
+// Set the display text for a memory slot
+void write_memory_text(SimulatorContext &ctx, unsigned int address,
+                       const string &instruction, const string &mnemonic)
+{
+     if (address < 256)
+     {
+          ctx.memory_text[address].instruction = instruction;
+          ctx.memory_text[address].mnemonic = mnemonic;
+          ctx.memory_text[address].valid = true;
+     }
      else
           cerr << "Memory write out of bounds: " << address << endl;
 }
 
 // Display memory contents
-void display_memory(unsigned int start, unsigned int end)
+void display_memory(SimulatorContext &ctx, unsigned int start, unsigned int end)
 {
      cout << "\n=== CPU Memory Contents ===" << endl;
      cout << "Address | Instruction         | Mnemonic | Opcode | Data   | Valid" << endl;
@@ -97,13 +120,17 @@ void display_memory(unsigned int start, unsigned int end)
 
      for (unsigned int i = start; i <= end && i < 256; i++)
      {
-          if (main_memory[i].valid)
+          if (ctx.memory_text[i].valid)
           {
+               InstructionWord word = ctx.main_memory[i];
+               char data[8];
+               snprintf(data, sizeof(data), "0x%02X", instruction_data(word));
+
                cout << "0x" << hex << setw(2) << setfill('0') << i << setfill(' ')
-                    << "     | " << left << setw(19) << main_memory[i].instruction << right
-                    << " | " << setw(8) << main_memory[i].mnemonic
-                    << " | 0x" << hex << setw(2) << setfill('0') << (int)main_memory[i].opcode << setfill(' ')
-                    << "   | " << setw(6) << main_memory[i].data
+                    << "     | " << left << setw(19) << ctx.memory_text[i].instruction << right
+                    << " | " << setw(8) << ctx.memory_text[i].mnemonic
+                    << " | 0x" << hex << setw(2) << setfill('0') << (int)instruction_opcode(word) << setfill(' ')
+                    << "   | " << setw(6) << data
                     << " | YES" << dec << endl;
           }
      }
@@ -111,15 +138,15 @@ void display_memory(unsigned int start, unsigned int end)
 }
 
 // Display program section (addresses 0x00 - 0x0F)
-void display_program_section()
+void display_program_section(SimulatorContext &ctx)
 {
      cout << "\n=== PROGRAM SECTION (0x00 - 0x0F) ===" << endl;
-     display_memory(0x00, 0x0F);
+     display_memory(ctx, 0x00, 0x0F);
 }
 
 // Display data section
-void display_data_section()
+void display_data_section(SimulatorContext &ctx)
 {
      cout << "\n=== DATA SECTION (0x0A - 0x0F) ===" << endl;
-     display_memory(0x0A, 0x0F);
+     display_memory(ctx, 0x0A, 0x0F);
 }
@@ -0,0 +1,86 @@
+#include "memory_trace.h"
+#include <cstring>
+#include <iostream>
+
+using namespace std;
+
+// Create path and write the header
+bool open_memory_trace(MemoryTraceWriter &writer, const string &path)
+{
+    writer.file = fopen(path.c_str(), "wb");
+    if (writer.file == nullptr)
+    {
+        cerr << "Error: Could not open memory trace file " << path << endl;
+        return false;
+    }
+
+    MemoryTraceHeader header;
+    memcpy(header.magic, MEMORY_TRACE_MAGIC, sizeof(header.magic));
+    header.version = MEMORY_TRACE_VERSION;
+    header.header_size = sizeof(header);
+    fwrite(&header, sizeof(header), 1, writer.file);
+
+    writer.buffer = new MemoryTraceRecord[MEMORY_TRACE_BUFFER];
+    writer.used = 0;
+    writer.accesses = 0;
+    writer.last_instruction = 0;
+    return true;
+}
+
+// Write the buffered records
+void flush_memory_trace(MemoryTraceWriter &writer)
+{
+    if (writer.used > 0)
+        fwrite(writer.buffer, sizeof(MemoryTraceRecord), writer.used, writer.file);
+    writer.used = 0;
+}
+
+// Flush and close; returns the file size in bytes
+uint64_t close_memory_trace(MemoryTraceWriter &writer)
+{
+    flush_memory_trace(writer);
+
+    uint64_t size = (uint64_t)ftell(writer.file);
+    fclose(writer.file);
+    delete[] writer.buffer;
+    writer.file = nullptr;
+    writer.buffer = nullptr;
+    return size;
+}
+
+// Read a whole trace; false if path is missing or not a memory trace
+bool load_memory_trace(const string &path, vector<MemoryTraceRecord> &records)
+{
+    records.clear();
+
+    FILE *in = fopen(path.c_str(), "rb");
+    if (in == nullptr)
+    {
+        cerr << "Error: Could not open " << path << endl;
+        return false;
+    }
+
+    MemoryTraceHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        memcmp(header.magic, MEMORY_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != MEMORY_TRACE_VERSION || header.header_size != sizeof(header))
+    {
+        cerr << "Error: " << path << " is not a version " << MEMORY_TRACE_VERSION
+             << " memory trace" << endl;
+        fclose(in);
+        return false;
+    }
+
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, sizeof(header), SEEK_SET);
+
+    size_t count = (size_t)(size - (long)sizeof(header)) / sizeof(MemoryTraceRecord);
+    records.resize(count);
+    bool ok = count == 0 || fread(&records[0], sizeof(MemoryTraceRecord), count, in) == count;
+    fclose(in);
+
+    if (!ok)
+        cerr << "Error: " << path << " is truncated" << endl;
+    return ok;
+}
@@ -0,0 +1,91 @@
+#ifndef MEMORY_TRACE_H
+#define MEMORY_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+     Memory access trace (--mem-trace file)
+     Header:  MemoryTraceHeader (magic "ISAM", version, header size)
+     Records: 4 bytes per data access, in execution order
+              [flags] [PC] [address] [gap]
+     gap is the number of instructions retired since the previous
+     access (saturating at 255); replay uses it to pace the write
+     buffer. The address stream does not depend on timing, so a trace
+     recorded in any mode can be replayed by cache_replay through
+     cache_read() / cache_write() alone, for any number of cache
+     configurations, without re-running the pipeline.
+*/
+
+const char MEMORY_TRACE_MAGIC[4] = { 'I', 'S', 'A', 'M' };
+const uint16_t MEMORY_TRACE_VERSION = 2;
+const size_t MEMORY_TRACE_BUFFER = 1 << 16;    // Records buffered per fwrite
+
+// Record flags (MemoryTraceRecord::flags)
+enum MemoryTraceFlags
+{
+    MEMORY_TRACE_WRITE = 1 << 0     // ST (otherwise LD)
+};
+
+#pragma pack(push, 1)
+struct MemoryTraceHeader
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;           // sizeof(MemoryTraceHeader)
+};
+
+struct MemoryTraceRecord
+{
+    uint8_t flags;      // MemoryTraceFlags
+    uint8_t pc;         // Address of the LD/ST instruction
+    uint8_t address;    // Data address (MAR)
+    uint8_t gap;        // Instructions since the previous access (max 255)
+};
+#pragma pack(pop)
+
+// Open trace file plus its write buffer (one per SimulatorContext)
+struct MemoryTraceWriter
+{
+    FILE *file;
+    MemoryTraceRecord *buffer;
+    size_t used;            // Records in buffer
+    uint64_t accesses;      // Records written
+    uint64_t last_instruction;  // Instruction count at the previous access
+};
+
+// Create path and write the header
+bool open_memory_trace(MemoryTraceWriter &writer, const string &path);
+
+// Write the buffered records
+void flush_memory_trace(MemoryTraceWriter &writer);
+
+// Flush and close; returns the file size in bytes
+uint64_t close_memory_trace(MemoryTraceWriter &writer);
+
+// Read a whole trace; false if path is missing or not a memory trace
+bool load_memory_trace(const string &path, vector<MemoryTraceRecord> &records);
+
+// Record one data access; instructions is the run's instruction count
+inline void memory_trace_access(MemoryTraceWriter &writer, uint64_t instructions, uint8_t pc,
+                                uint8_t address, bool is_write)
+{
+    uint64_t gap = instructions - writer.last_instruction;
+    writer.last_instruction = instructions;
+
+    MemoryTraceRecord &record = writer.buffer[writer.used++];
+    record.flags = is_write ? MEMORY_TRACE_WRITE : 0;
+    record.pc = pc;
+    record.address = address;
+    record.gap = gap > 255 ? 255 : (uint8_t)gap;
+    writer.accesses++;
+
+    if (writer.used == MEMORY_TRACE_BUFFER)
+        flush_memory_trace(writer);
+}
+
+#endif // MEMORY_TRACE_H
@@ -0,0 +1,231 @@
+#include "perfetto_trace.h"
+#include "program_loader.h"
+#include <iostream>
+
+using namespace std;
+
+// Track ids (thread ids of the single "Pipeline" process)
+enum PerfettoTrack
+{
+    TRACK_IF = 1,
+    TRACK_EX = 2,
+    TRACK_CACHE = 3,
+    TRACK_STALLS = 4
+};
+
+// Append one formatted event, writing the chunk once it is full
+static void emit(PerfettoTraceWriter &writer, const char *event)
+{
+    if (writer.events > 0)
+        writer.chunk += ",\n";
+    writer.chunk += event;
+    writer.events++;
+
+    if (writer.chunk.size() >= PERFETTO_CHUNK_BYTES)
+    {
+        fwrite(writer.chunk.data(), 1, writer.chunk.size(), writer.file);
+        writer.chunk.clear();
+    }
+}
+
+// Complete ("X") event covering cycles [start, end)
+static void emit_slice(PerfettoTraceWriter &writer, int track, const char *category, const string &name,
+                       uint64_t start, uint64_t end, int pc)
+{
+    char event[256];
+    snprintf(event, sizeof(event),
+             "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"cat\":\"%s\",\"name\":\"%s\",\"ts\":%llu,\"dur\":%llu,"
+             "\"args\":{\"pc\":\"0x%02X\"}}",
+             track, category, name.c_str(), (unsigned long long)start,
+             (unsigned long long)(end - start), pc);
+    emit(writer, event);
+}
+
+// Name a track and fix its position in the viewer
+static void emit_track_name(PerfettoTraceWriter &writer, int track, const char *name)
+{
+    char event[256];
+    snprintf(event, sizeof(event),
+             "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_name\",\"args\":{\"name\":\"%s\"}}",
+             track, name);
+    emit(writer, event);
+    snprintf(event, sizeof(event),
+             "{\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"name\":\"thread_sort_index\",\"args\":{\"sort_index\":%d}}",
+             track, track);
+    emit(writer, event);
+}
+
+static void close_ex_slice(PerfettoTraceWriter &writer, uint64_t end)
+{
+    if (writer.ex.open)
+        emit_slice(writer, TRACK_EX, "ex", writer.names[writer.ex.pc], writer.ex.start, end, writer.ex.pc);
+    writer.ex.open = false;
+}
+
+static void close_stall_slice(PerfettoTraceWriter &writer, uint64_t end)
+{
+    if (!writer.stall.open)
+        return;
+
+    const char *name = "flush";
+    if (writer.stall.kind == TRACE_CACHE_STALL)
+        name = "cache stall";
+    else if (writer.stall.kind == TRACE_STALL)
+        name = "load-use stall";
+    emit_slice(writer, TRACK_STALLS, "stall", name, writer.stall.start, end, writer.stall.pc);
+    writer.stall.open = false;
+}
+
+// Create path, write the track names and take instruction text from ctx
+bool open_perfetto_trace(PerfettoTraceWriter &writer, const string &path, SimulatorContext &ctx)
+{
+    writer.file = fopen(path.c_str(), "w");
+    if (writer.file == nullptr)
+    {
+        cerr << "Error: Could not open trace file " << path << endl;
+        return false;
+    }
+
+    // Names go into JSON strings unescaped; the disassembler never
+    // produces quotes or backslashes
+    for (int i = 0; i < 256; i++)
+    {
+        if (ctx.memory_text[i].valid)
+        {
+            writer.names[i] = ctx.memory_text[i].instruction;
+        }
+        else
+        {
+            string mnemonic;
+            disassemble(ctx.main_memory[i], writer.names[i], mnemonic);
+        }
+    }
+
+    writer.chunk.clear();
+    writer.chunk.reserve(PERFETTO_CHUNK_BYTES + 512);
+    writer.chunk += "{\"traceEvents\":[\n";
+    writer.ex.open = false;
+    writer.stall.open = false;
+    writer.last_status = 0;
+    writer.last_cycle = 0;
+    writer.flows = 0;
+    writer.events = 0;
+
+    emit(writer, "{\"ph\":\"M\",\"pid\":1,\"name\":\"process_name\",\"args\":{\"name\":\"Pipeline\"}}");
+    emit_track_name(writer, TRACK_IF, "IF");
+    emit_track_name(writer, TRACK_EX, "EX");
+    emit_track_name(writer, TRACK_CACHE, "Cache");
+    emit_track_name(writer, TRACK_STALLS, "Stalls");
+    return true;
+}
+
+// Add one cycle (the same record the binary trace gets)
+void perfetto_cycle(PerfettoTraceWriter &writer, uint64_t cycle, const PipelineTraceRecord &record)
+{
+    // EX: a new instruction enters the cycle after a fetch; a bubble or
+    // an empty pipeline closes the slice
+    if (!(record.status & TRACE_EX_VALID))
+    {
+        close_ex_slice(writer, cycle);
+    }
+    else if (!writer.ex.open || (writer.last_status & TRACE_IF_VALID) || writer.ex.pc != record.ex_pc)
+    {
+        close_ex_slice(writer, cycle);
+        writer.ex.open = true;
+        writer.ex.start = cycle;
+        writer.ex.pc = record.ex_pc;
+    }
+
+    // IF: one slice per fetch
+    if (record.status & TRACE_IF_VALID)
+        emit_slice(writer, TRACK_IF, "if", writer.names[record.if_pc], cycle, cycle + 1, record.if_pc);
+
+    // Stalls: coalesce consecutive cycles of the same kind
+    uint8_t kind = 0;
+    if (record.status & TRACE_CACHE_STALL)
+        kind = TRACE_CACHE_STALL;
+    else if (record.status & TRACE_STALL)
+        kind = TRACE_STALL;
+    else if (record.status & TRACE_FLUSH)
+        kind = TRACE_FLUSH;
+
+    if (writer.stall.open && writer.stall.kind != kind)
+        close_stall_slice(writer, cycle);
+    if (kind != 0 && !writer.stall.open)
+    {
+        writer.stall.open = true;
+        writer.stall.start = cycle;
+        writer.stall.pc = record.ex_pc;
+        writer.stall.kind = kind;
+    }
+
+    char event[256];
+
+    // Forwarding: the load in EX now feeds the instruction fetched this
+    // cycle, which executes next cycle
+    if (record.status & TRACE_FORWARD)
+    {
+        writer.flows++;
+        snprintf(event, sizeof(event),
+                 "{\"ph\":\"s\",\"pid\":1,\"tid\":%d,\"cat\":\"forward\",\"name\":\"forward\",\"id\":%llu,"
+                 "\"ts\":%llu,\"bp\":\"e\"}",
+                 TRACK_EX, (unsigned long long)writer.flows, (unsigned long long)cycle);
+        emit(writer, event);
+        snprintf(event, sizeof(event),
+                 "{\"ph\":\"f\",\"pid\":1,\"tid\":%d,\"cat\":\"forward\",\"name\":\"forward\",\"id\":%llu,"
+                 "\"ts\":%llu,\"bp\":\"e\"}",
+                 TRACK_EX, (unsigned long long)writer.flows, (unsigned long long)(cycle + 1));
+        emit(writer, event);
+    }
+
+    if (record.status & TRACE_HALT)
+    {
+        snprintf(event, sizeof(event),
+                 "{\"ph\":\"i\",\"pid\":1,\"tid\":%d,\"cat\":\"ex\",\"name\":\"HALT\",\"ts\":%llu,\"s\":\"t\"}",
+                 TRACK_EX, (unsigned long long)cycle);
+        emit(writer, event);
+    }
+
+    writer.last_status = record.status;
+    writer.last_cycle = cycle;
+}
+
+// Add a data cache access made by the instruction at pc
+void perfetto_cache_access(PerfettoTraceWriter &writer, uint64_t cycle, uint8_t pc, uint8_t address,
+                           bool is_write, bool hit, int stall_cycles)
+{
+    char event[256];
+    snprintf(event, sizeof(event),
+             "{\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"cat\":\"cache\",\"name\":\"%s %s 0x%02X\",\"ts\":%llu,"
+             "\"dur\":%d,\"args\":{\"pc\":\"0x%02X\",\"address\":\"0x%02X\",\"stall_cycles\":%d}}",
+             TRACK_CACHE, is_write ? "ST" : "LD", hit ? "hit" : "miss", address,
+             (unsigned long long)cycle, stall_cycles + 1, pc, address, stall_cycles);
+    emit(writer, event);
+}
+
+// Add an I-cache miss holding the fetch of pc for stall_cycles
+void perfetto_icache_miss(PerfettoTraceWriter &writer, uint64_t cycle, uint8_t pc, int stall_cycles)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "I-cache miss 0x%02X", pc);
+    emit_slice(writer, TRACK_IF, "icache", name, cycle, cycle + stall_cycles, pc);
+}
+
+// Close the open slices, end the JSON and close; returns the file size in bytes
+uint64_t close_perfetto_trace(PerfettoTraceWriter &writer)
+{
+    close_ex_slice(writer, writer.last_cycle + 1);
+    close_stall_slice(writer, writer.last_cycle + 1);
+
+    char footer[128];
+    snprintf(footer, sizeof(footer), "\n],\n\"otherData\":{\"time_unit\":\"1 us = 1 cycle\",\"cycles\":%llu}}\n",
+             (unsigned long long)writer.last_cycle);
+    writer.chunk += footer;
+    fwrite(writer.chunk.data(), 1, writer.chunk.size(), writer.file);
+    writer.chunk.clear();
+
+    uint64_t size = (uint64_t)ftell(writer.file);
+    fclose(writer.file);
+    writer.file = nullptr;
+    return size;
+}
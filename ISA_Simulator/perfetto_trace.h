@@ -0,0 +1,73 @@
+#ifndef PERFETTO_TRACE_H
+#define PERFETTO_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "pipeline_trace.h"
+#include "simulator_context.h"
+
+using namespace std;
+
+/*
+     Chrome Trace Event / Perfetto JSON export (--perfetto file)
+     Open the file in ui.perfetto.dev or chrome://tracing. One simulated
+     cycle is one microsecond of trace time.
+     Tracks (threads of the "Pipeline" process):
+          IF     - one slice per fetch
+          EX     - one slice per instruction, from the cycle it enters EX
+                   until the next one replaces it (a load held in EX by a
+                   miss stays visible for the whole penalty)
+          Cache  - one slice per access (hit/miss, address, latency)
+          Stalls - coalesced cache stall (cache_stall_remaining),
+                   load-use stall and flush windows
+     Forwarding events are flow arrows from the producing load's EX slice
+     to the consumer's EX slice.
+     Tracks are built from PipelineTraceRecords, so only issue width 1 is
+     exported.
+     Events are formatted as they complete and written in
+     PERFETTO_CHUNK_BYTES chunks, so memory stays flat for any run length.
+*/
+
+const size_t PERFETTO_CHUNK_BYTES = 1 << 16;   // Bytes buffered per fwrite
+
+// An open slice on one track
+struct PerfettoSlice
+{
+    bool open;
+    uint64_t start;     // First cycle
+    uint8_t pc;
+    uint8_t kind;       // Stalls track: PipelineTraceStatus bit
+};
+
+// Open JSON file and the per-track state (one per SimulatorContext)
+struct PerfettoTraceWriter
+{
+    FILE *file;
+    string chunk;               // Formatted events not yet written
+    string names[256];          // Instruction text per address
+    PerfettoSlice ex;
+    PerfettoSlice stall;
+    uint8_t last_status;        // Previous cycle's status bits
+    uint64_t last_cycle;
+    uint64_t flows;             // Flow ids handed out
+    uint64_t events;            // Events written
+};
+
+// Create path, write the track names and take instruction text from ctx
+bool open_perfetto_trace(PerfettoTraceWriter &writer, const string &path, SimulatorContext &ctx);
+
+// Add one cycle (the same record the binary trace gets)
+void perfetto_cycle(PerfettoTraceWriter &writer, uint64_t cycle, const PipelineTraceRecord &record);
+
+// Add a data cache access made by the instruction at pc
+void perfetto_cache_access(PerfettoTraceWriter &writer, uint64_t cycle, uint8_t pc, uint8_t address,
+                           bool is_write, bool hit, int stall_cycles);
+
+// Add an I-cache miss holding the fetch of pc for stall_cycles
+void perfetto_icache_miss(PerfettoTraceWriter &writer, uint64_t cycle, uint8_t pc, int stall_cycles);
+
+// Close the open slices, end the JSON and close; returns the file size in bytes
+uint64_t close_perfetto_trace(PerfettoTraceWriter &writer);
+
+#endif // PERFETTO_TRACE_H
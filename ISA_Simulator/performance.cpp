@@ -1,94 +1,143 @@
 #include "performance.h"
+#include "simulator_context.h"
 #include "cache.h"
 #include <iostream>
 #include <iomanip>
 
 using namespace std;
 
-// Performance Counters
-uint64_t cycle_count = 0;
-uint64_t instruction_count = 0;
-uint64_t stall_count = 0;
-uint64_t flush_count = 0;
-uint64_t forwarding_count = 0;
-
 // Initialize performance counters
-void initialize_performance()
+void initialize_performance(SimulatorContext &ctx)
 {
-    cycle_count = 0;
-    instruction_count = 0;
-    stall_count = 0;
-    flush_count = 0;
-    forwarding_count = 0;
+    ctx.cycle_count = 0;
+    ctx.instruction_count = 0;
+    ctx.stall_count = 0;
+    ctx.flush_count = 0;
+    ctx.forwarding_count = 0;
+    ctx.forward_ex_ex = 0;
+    ctx.forward_mem_ex = 0;
+    ctx.forward_wb_id = 0;
+    ctx.branch_count = 0;
+    ctx.branch_mispredicts = 0;
+    ctx.issue_dependency_splits = 0;
+    ctx.issue_port_splits = 0;
 }
 
 // Increment cycle counter
-void increment_cycle()
+void increment_cycle(SimulatorContext &ctx)
 {
-    cycle_count++;
+    ctx.cycle_count++;
 }
 
 // Increment instruction counter
-void increment_instruction()
+void increment_instruction(SimulatorContext &ctx)
 {
-    instruction_count++;
+    ctx.instruction_count++;
 }
 
 // Increment stall counter
-void increment_stall()
+void increment_stall(SimulatorContext &ctx)
 {
-    stall_count++;
+    ctx.stall_count++;
 }
 
 // Increment flush counter
-void increment_flush()
+void increment_flush(SimulatorContext &ctx)
 {
-    flush_count++;
+    ctx.flush_count++;
 }
 
 // Increment forwarding counter (Assignment IV Part A)
-void increment_forwarding()
+void increment_forwarding(SimulatorContext &ctx)
 {
-    forwarding_count++;
+    ctx.forwarding_count++;
 }
 
 // Calculate CPI (Cycles Per Instruction)
-double calculate_cpi()
+double calculate_cpi(SimulatorContext &ctx)
+{
+    if (ctx.instruction_count == 0)
+        return 0.0;
+    return (double)ctx.cycle_count / (double)ctx.instruction_count;
+}
+
+// Calculate IPC (Instructions Per Cycle)
+double calculate_ipc(SimulatorContext &ctx)
 {
-    if (instruction_count == 0)
+    if (ctx.cycle_count == 0)
         return 0.0;
-    return (double)cycle_count / (double)instruction_count;
+    return (double)ctx.instruction_count / (double)ctx.cycle_count;
 }
 
 // Display performance statistics in assignment-required format
-void display_performance()
+void display_performance(SimulatorContext &ctx)
 {
-    // Calculate total stalls (hazard + cache)
-    uint64_t total_stalls = stall_count + cache_stall_cycles;
+    // Calculate total stalls (hazard + data cache + I-cache)
+    uint64_t total_stalls = ctx.stall_count + ctx.cache_stall_cycles + ctx.icache_stall_cycles;
     
     cout << "\n========================================" << endl;
     cout << "     PERFORMANCE MEASUREMENT" << endl;
     cout << "========================================" << endl;
-    cout << "Total cycles = " << cycle_count << endl;
-    cout << "Total instructions = " << instruction_count << endl;
-    cout << "CPI = cycles / instructions = " << fixed << setprecision(3) << calculate_cpi() << endl;
+    cout << "Total cycles = " << ctx.cycle_count << endl;
+    cout << "Total instructions = " << ctx.instruction_count << endl;
+    cout << "CPI = cycles / instructions = " << fixed << setprecision(3) << calculate_cpi(ctx) << endl;
     cout << "Number of stalls = " << total_stalls << endl;
-    cout << "Number of forwardings = " << forwarding_count << endl;
-    cout << "Cache hits = " << cache_hits << endl;
-    cout << "Cache misses = " << cache_misses << endl;
+    cout << "Number of forwardings = " << ctx.forwarding_count << endl;
+    cout << "Cache hits = " << ctx.cache_hits << endl;
+    cout << "Cache misses = " << ctx.cache_misses << endl;
     cout << "========================================" << endl;
     cout << endl;
     
     // Detailed breakdown
     cout << "--- Detailed Breakdown ---" << endl;
-    cout << "  Hazard stalls:     " << stall_count << endl;
-    cout << "  Cache stall cycles: " << cache_stall_cycles << endl;
-    cout << "  Flush operations:   " << flush_count << endl;
+    cout << "  Hazard stalls:     " << ctx.stall_count << endl;
+    cout << "  Cache stall cycles: " << ctx.cache_stall_cycles << endl;
+    cout << "  I-cache stall cycles: " << ctx.icache_stall_cycles << endl;
+    cout << "  Flush operations:   " << ctx.flush_count << endl;
     
-    uint64_t total_accesses = cache_hits + cache_misses;
+    uint64_t total_accesses = ctx.cache_hits + ctx.cache_misses;
     double hit_rate = 0.0;
     if (total_accesses > 0)
-        hit_rate = (double)cache_hits / (double)total_accesses * 100.0;
+        hit_rate = (double)ctx.cache_hits / (double)total_accesses * 100.0;
     cout << "  Cache hit rate:     " << fixed << setprecision(2) << hit_rate << "%" << endl;
     cout << endl;
+    
+    // Branch prediction (every JMP mispredicts without a predictor)
+    if (ctx.branch_count > 0)
+    {
+        double accuracy = 100.0 * (ctx.branch_count - ctx.branch_mispredicts) / ctx.branch_count;
+        double mpki = ctx.instruction_count > 0 ? 1000.0 * ctx.branch_mispredicts / ctx.instruction_count : 0.0;
+        cout << "--- Branch Prediction (" << branch_predictor_name(ctx.branch_predictor) << ") ---" << endl;
+        cout << "  Branches:           " << ctx.branch_count << endl;
+        cout << "  Mispredicts:        " << ctx.branch_mispredicts << endl;
+        cout << "  Accuracy:           " << fixed << setprecision(2) << accuracy << "%" << endl;
+        cout << "  MPKI:               " << fixed << setprecision(2) << mpki << endl;
+        cout << endl;
+    }
+    
+    // Deeper pipelines: where operands came from and what mispredicts cost
+    if (ctx.pipeline_depth > 2)
+    {
+        const PipelineLayout &layout = ctx.pipeline_layout;
+        cout << "--- Pipeline (" << layout.depth << " stages: " << describe_pipeline_layout(layout) << ") ---" << endl;
+        cout << "  Branch penalty:     " << layout.execute << " cycles/flush ("
+             << ctx.flush_count * layout.execute << " cycles)" << endl;
+        cout << "  EX->EX forwards:    " << ctx.forward_ex_ex << endl;
+        cout << "  MEM->EX forwards:   " << ctx.forward_mem_ex << endl;
+        cout << "  WB->ID bypasses:    " << ctx.forward_wb_id << endl;
+        cout << endl;
+    }
+    
+    // Superscalar: how many of the issue slots did useful work
+    if (ctx.issue_width > 1)
+    {
+        double utilization = ctx.cycle_count > 0
+            ? 100.0 * ctx.instruction_count / (ctx.cycle_count * ctx.issue_width) : 0.0;
+        cout << "--- Superscalar (" << ctx.issue_width << "-wide issue) ---" << endl;
+        cout << "  IPC:                " << fixed << setprecision(3) << calculate_ipc(ctx) << endl;
+        cout << "  Issue-slot use:     " << fixed << setprecision(2) << utilization << "%" << endl;
+        cout << "  Dependency splits:  " << ctx.issue_dependency_splits << endl;
+        cout << "  Port splits:        " << ctx.issue_port_splits << endl;
+        cout << endl;
+    }
 }
@@ -3,35 +3,36 @@
 
 #include <cstdint>
 
-// Performance Counters
-extern uint64_t cycle_count;        // Total cycles
-extern uint64_t instruction_count;  // Instructions completed
-extern uint64_t stall_count;        // Stall cycles
-extern uint64_t flush_count;        // Flush operations
-extern uint64_t forwarding_count;   // Forwarding operations (Assignment IV Part A)
+struct SimulatorContext;
+
+// Performance Counters (cycle_count, instruction_count, stall_count,
+// flush_count, forwarding_count) live in SimulatorContext.
 
 // Initialize performance counters
-void initialize_performance();
+void initialize_performance(SimulatorContext &ctx);
 
 // Increment cycle counter
-void increment_cycle();
+void increment_cycle(SimulatorContext &ctx);
 
 // Increment instruction counter
-void increment_instruction();
+void increment_instruction(SimulatorContext &ctx);
 
 // Increment stall counter
-void increment_stall();
+void increment_stall(SimulatorContext &ctx);
 
 // Increment flush counter
-void increment_flush();
+void increment_flush(SimulatorContext &ctx);
 
 // Increment forwarding counter (Assignment IV Part A)
-void increment_forwarding();
+void increment_forwarding(SimulatorContext &ctx);
 
 // Calculate and return CPI
-double calculate_cpi();
+double calculate_cpi(SimulatorContext &ctx);
+
+// Calculate and return IPC (instructions per cycle)
+double calculate_ipc(SimulatorContext &ctx);
 
 // Display performance statistics
-void display_performance();
+void display_performance(SimulatorContext &ctx);
 
 #endif // PERFORMANCE_H
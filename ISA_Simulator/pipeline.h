@@ -3,6 +3,8 @@
 
 #include <cstdint>
 #include <string>
+#include "trace_policy.h"
+#include "branch_predictor.h"
 
 using namespace std;
 
@@ -14,7 +16,7 @@ struct IFEX_Register
     uint8_t operand;      // Operand/Register address (4 bits)
     uint8_t address_data; // Immediate value or memory address
     uint8_t pc;           // PC of this instruction
-    string mnemonic;      // Mnemonic for debugging
+    const char *mnemonic; // Mnemonic for debugging (points into instruction memory)
     
     // For hazard detection
     uint8_t dest_reg;     // Destination register (for LD instructions)
@@ -24,6 +26,12 @@ struct IFEX_Register
     bool produces_result; // Does this instruction produce a result?
     uint8_t result_value; // The result value to forward
     bool result_ready;    // Is the result ready to forward?
+    
+    // Set once EX has run; the instruction then only waits out its
+    // cache stall and is not executed again
+    bool executed;
+    
+    BranchPrediction prediction;    // Next PC chosen at fetch
 };
 
 // Forwarding Unit State (Assignment IV Part A)
@@ -35,45 +43,138 @@ struct ForwardingUnit
     uint8_t forward_value;   // Value being forwarded
 };
 
-extern ForwardingUnit forwarding_unit;
+// N-stage pipeline
+// pipeline_depth 2 is the IF/EX model above: EX also accesses memory and
+// writes back. Deeper pipelines run the instruction through one
+// StageLatch per stage, laid out by configure_pipeline_layout():
+//      3: IF ID EX                     6: IF1 IF2 ID EX MEM WB
+//      4: IF ID EX MEM                 7: IF1 IF2 ID EX MEM1 MEM2 WB
+//      5: IF ID EX MEM WB              8: IF1 IF2 IF3 ID EX MEM1 MEM2 WB
+// ALU results exist at the end of EX, load results at the end of the
+// last MEM stage. An instruction leaves ID once its source registers
+// can be forwarded to it in EX: EX->EX (ALU result one stage ahead),
+// MEM->EX (load result or older ALU result further down) or WB->ID (the
+// register file is written before it is read in the same cycle).
+// Without forwarding only WB->ID is available. Branches and HALT
+// resolve in EX and squash the stages before it, so a mispredicted
+// branch costs one cycle per stage ahead of EX.
+#define PIPELINE_DEPTH 2            // Default stage count
+#define MAX_PIPELINE_DEPTH 8
+
+// Superscalar issue (issue_width > 1, deeper pipelines only)
+// Every stage holds a group of up to issue_width instructions, oldest in
+// slot 0. Fetch takes issue_width sequential instructions per cycle and
+// stops after a predicted-taken branch. ID issues its group in order and
+// stops at the first instruction that cannot go: an operand not yet
+// available, a register dependency on an earlier instruction of the same
+// group (no same-cycle forwarding), or no free port of its kind.
+// Branches, JMP and HALT end the group. Instructions left in ID issue
+// the next cycle, and fetch waits until ID is empty.
+#define ISSUE_WIDTH 1               // Default: scalar
+#define MAX_ISSUE_WIDTH 4
+#define ISSUE_ALU_PORTS 2           // ALU ops (and anything else)
+#define ISSUE_MEMORY_PORTS 1        // LD/ST
+#define ISSUE_BRANCH_PORTS 1        // JMP, BEQZ/BNEZ, HALT
+
+enum StageKind
+{
+    STAGE_FETCH,
+    STAGE_DECODE,       // Hazard check, register read
+    STAGE_EXECUTE,      // ALU, branches, HALT
+    STAGE_MEMORY,       // LD/ST access in the first one
+    STAGE_WRITEBACK
+};
+
+// Stage indices of one pipeline depth
+struct PipelineLayout
+{
+    int depth;
+    int decode;         // ID (-1 for depth 2)
+    int execute;        // EX
+    int memory;         // Stage that accesses the cache (EX when there is no MEM stage)
+    int load_result;    // Stage at whose end a load's value exists
+    int writeback;      // WB, or -1 when the last stage writes the register file
+    StageKind kind[MAX_PIPELINE_DEPTH];
+};
+
+// One stage's latch: the instruction the stage holds this cycle
+struct StageLatch
+{
+    bool valid;
+    uint8_t pc;
+    uint8_t opcode;
+    uint8_t operand;
+    uint8_t address_data;
+    uint8_t flags;          // DecodeFlags
+    const char *mnemonic;
+    bool executed;          // EX has run it
+    bool accessed;          // LD/ST: the cache access is done
+    BranchPrediction prediction;    // Next PC chosen at fetch
+};
+
+// Decode flags (DecodedInstruction::flags)
+enum DecodeFlags
+{
+    DECODE_VALID        = 1 << 0,   // Memory slot holds an instruction
+    DECODE_LOAD         = 1 << 1,   // LD: reads data memory into operand register
+    DECODE_STORE        = 1 << 2,   // ST: writes operand register to data memory
+    DECODE_JUMP         = 1 << 3,   // JMP: redirects PC
+    DECODE_HALT         = 1 << 4,   // HALT
+    DECODE_WRITES_REG   = 1 << 5,   // Produces a register result (ALU ops, LD)
+    DECODE_BRANCH       = 1 << 6    // BEQZ/BNEZ: conditional on the operand register
+};
+
+// Decoded instruction
+// One entry per instruction memory slot, built once when the program is
+// loaded (predecode_program) so fetch and hazard detection only index the
+// table and never parse strings on the per-cycle path.
+struct DecodedInstruction
+{
+    uint8_t opcode;
+    uint8_t operand;
+    uint8_t address_data;
+    uint8_t flags;          // DecodeFlags
+};
 
-// Global pipeline register
-extern IFEX_Register ifex_reg;
+struct SimulatorContext;
 
-// Pipeline control flags
-extern bool stall_flag;       // Insert stall this cycle
-extern bool flush_flag;       // Flush pipeline this cycle
+// The IF/EX register, the stage groups of deeper pipelines, the
+// forwarding unit, stall/flush flags and the remaining cache stall
+// cycles live in SimulatorContext.
+// Functions templated on Trace are instantiated for QuietTrace and
+// VerboseTrace (trace_policy.h).
 
-// Cache stall management
-extern int cache_stall_remaining;  // Remaining cache stall cycles
+// Initialize pipeline (empty latches, layout for ctx.pipeline_depth)
+void initialize_pipeline(SimulatorContext &ctx);
 
-// Initialize pipeline
-void initialize_pipeline();
+// Build the decoded-instruction table from instruction memory
+void predecode_program(SimulatorContext &ctx);
 
-// IF Stage: Instruction Fetch
-void instruction_fetch();
+// Re-decode one slot (after write_memory changes it)
+void predecode_instruction(SimulatorContext &ctx, uint8_t address);
 
-// EX Stage: Execute / Memory / Writeback
-void execute_writeback();
+// Pre-decoded instruction stored at pc_value
+const DecodedInstruction &decode_instruction(SimulatorContext &ctx, uint8_t pc_value);
 
-// Hazard Detection
-bool detect_load_use_hazard();
+// Move instruction from IF to EX (update pipeline register)
+void update_pipeline_register(SimulatorContext &ctx);
 
-// Forwarding Unit (Assignment IV Part A)
-// Check if forwarding is possible for the current IF instruction
-bool check_forwarding(uint8_t required_reg, uint8_t &forwarded_value);
+// Flush pipeline: discard everything fetched after the instruction in
+// EX (the IF slot, or every stage before EX in deeper pipelines)
+template <class Trace>
+void flush_pipeline(SimulatorContext &ctx);
 
-// Check if the EX instruction can forward its result
-bool can_forward();
+// Fill layout for depth (2..MAX_PIPELINE_DEPTH); false if out of range
+bool configure_pipeline_layout(int depth, PipelineLayout &layout);
 
-// Insert stall (bubble)
-void insert_stall();
+// 1..MAX_ISSUE_WIDTH; widths above 1 need an ID stage (depth > 2)
+bool is_valid_issue_width(int width, int depth);
 
-// Flush pipeline
-void flush_pipeline();
+// "IF", "ID", "MEM2" ... (numbered when a kind has several stages)
+string pipeline_stage_name(const PipelineLayout &layout, int stage);
 
-// Display pipeline state
-void display_pipeline_state(int cycle);
+// "IF ID EX MEM WB"
+string describe_pipeline_layout(const PipelineLayout &layout);
 
 #endif // PIPELINE_H
 
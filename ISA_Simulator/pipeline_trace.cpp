@@ -0,0 +1,63 @@
+#include "pipeline_trace.h"
+#include <cstring>
+#include <ctime>
+#include <iostream>
+
+using namespace std;
+
+// Create path and write the header from ctx's instruction memory
+bool open_pipeline_trace(PipelineTraceWriter &writer, const string &path, SimulatorContext &ctx)
+{
+    writer.file = fopen(path.c_str(), "wb");
+    if (writer.file == nullptr)
+    {
+        cerr << "Error: Could not open trace file " << path << endl;
+        return false;
+    }
+
+    PipelineTraceHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PIPELINE_TRACE_MAGIC, sizeof(header.magic));
+    header.version = PIPELINE_TRACE_VERSION;
+    header.header_size = sizeof(header);
+    header.start_time = (uint64_t)time(0);
+    for (int i = 0; i < 256; i++)
+    {
+        header.words[i] = ctx.main_memory[i];
+        if (ctx.memory_text[i].valid)
+            header.valid[i / 8] |= (uint8_t)(1 << (i % 8));
+    }
+    fwrite(&header, sizeof(header), 1, writer.file);
+
+    writer.buffer = new uint8_t[PIPELINE_TRACE_BUFFER];
+    writer.used = 0;
+    memset(&writer.last, 0, sizeof(writer.last));
+    writer.last_cycle = 0;
+    writer.cycles = 0;
+    writer.records = 0;
+    return true;
+}
+
+// Write the buffered bytes
+void flush_pipeline_trace(PipelineTraceWriter &writer)
+{
+    if (writer.used > 0)
+        fwrite(writer.buffer, 1, writer.used, writer.file);
+    writer.used = 0;
+}
+
+// Write the trailer and close; returns the file size in bytes
+uint64_t close_pipeline_trace(PipelineTraceWriter &writer)
+{
+    flush_pipeline_trace(writer);
+
+    uint64_t total_cycles = writer.cycles;
+    fwrite(&total_cycles, sizeof(total_cycles), 1, writer.file);
+
+    uint64_t size = (uint64_t)ftell(writer.file);
+    fclose(writer.file);
+    delete[] writer.buffer;
+    writer.file = nullptr;
+    writer.buffer = nullptr;
+    return size;
+}
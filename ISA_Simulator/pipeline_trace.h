@@ -0,0 +1,148 @@
+#ifndef PIPELINE_TRACE_H
+#define PIPELINE_TRACE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "instruction_memory.h"
+#include "simulator_context.h"
+
+using namespace std;
+
+/*
+     Binary pipeline trace (--trace file)
+     Header:  PipelineTraceHeader (magic "ISAT", start time, the packed
+              instruction memory and its valid bitmap, so the decoder can
+              print the same instruction text as the simulator)
+     Records: 4 bytes per record
+              [status] [IF pc] [EX pc] [IF opcode << 4 | EX opcode]
+              followed by a LEB128 cycle delta when status has
+              TRACE_DELTA; otherwise the delta is 1.
+              A record is written only when the pipeline state differs
+              from the previous one, so cache stall runs cost nothing;
+              the decoder repeats the previous state for skipped cycles.
+     Trailer: uint64_t total cycles (covers a final unchanged run)
+     All integers are little-endian. trace_decode turns a trace back into
+     the pipeline.txt text format or CSV.
+     Records hold a single IF/EX slot, so only issue width 1 is traced.
+*/
+
+const char PIPELINE_TRACE_MAGIC[4] = { 'I', 'S', 'A', 'T' };
+const uint16_t PIPELINE_TRACE_VERSION = 1;
+const size_t PIPELINE_TRACE_BUFFER = 1 << 20;   // Bytes buffered per fwrite
+
+// Status bitfield (PipelineTraceRecord::status)
+enum PipelineTraceStatus
+{
+    TRACE_IF_VALID      = 1 << 0,   // An instruction was fetched this cycle
+    TRACE_EX_VALID      = 1 << 1,   // EX holds an instruction this cycle
+    TRACE_STALL         = 1 << 2,   // Load-use stall (bubble inserted)
+    TRACE_FLUSH         = 1 << 3,   // Fetch discarded by a mispredicted JMP/branch
+    TRACE_FORWARD       = 1 << 4,   // Load result forwarded
+    TRACE_CACHE_STALL   = 1 << 5,   // Waiting on a cache access
+    TRACE_HALT          = 1 << 6,   // HALT executed
+    TRACE_DELTA         = 1 << 7    // LEB128 cycle delta follows
+};
+
+#pragma pack(push, 1)
+struct PipelineTraceHeader
+{
+    char magic[4];
+    uint16_t version;
+    uint16_t header_size;           // sizeof(PipelineTraceHeader)
+    uint64_t start_time;            // time() when the trace was opened
+    InstructionWord words[256];     // Instruction memory at start of run
+    uint8_t valid[32];              // Bit per slot: memory_text[i].valid
+};
+
+struct PipelineTraceRecord
+{
+    uint8_t status;     // PipelineTraceStatus bits (TRACE_DELTA is added on write)
+    uint8_t if_pc;
+    uint8_t ex_pc;
+    uint8_t opcodes;    // IF opcode << 4 | EX opcode
+};
+#pragma pack(pop)
+
+// Open trace file plus its write buffer (one per SimulatorContext)
+struct PipelineTraceWriter
+{
+    FILE *file;
+    uint8_t *buffer;
+    size_t used;
+    PipelineTraceRecord last;   // Last record written
+    uint64_t last_cycle;        // Cycle of the last record written
+    uint64_t cycles;            // Cycles traced
+    uint64_t records;           // Records written
+};
+
+// Create path and write the header from ctx's instruction memory
+bool open_pipeline_trace(PipelineTraceWriter &writer, const string &path, SimulatorContext &ctx);
+
+// Write the trailer and close; returns the file size in bytes
+uint64_t close_pipeline_trace(PipelineTraceWriter &writer);
+
+// Write the buffered bytes
+void flush_pipeline_trace(PipelineTraceWriter &writer);
+
+// Start a cycle's record with the instruction currently in EX
+inline void trace_begin_cycle(const SimulatorContext &ctx, PipelineTraceRecord &record)
+{
+    record.status = ctx.ifex_reg.valid ? TRACE_EX_VALID : 0;
+    record.if_pc = 0;
+    record.ex_pc = ctx.ifex_reg.valid ? ctx.ifex_reg.pc : 0;
+    record.opcodes = ctx.ifex_reg.valid ? (ctx.ifex_reg.opcode & 0x0F) : 0;
+}
+
+// Deeper pipelines: start the record with the EX stage's latch
+inline void trace_begin_cycle(const StageLatch &ex, PipelineTraceRecord &record)
+{
+    record.status = ex.valid ? TRACE_EX_VALID : 0;
+    record.if_pc = 0;
+    record.ex_pc = ex.valid ? ex.pc : 0;
+    record.opcodes = ex.valid ? (ex.opcode & 0x0F) : 0;
+}
+
+// Record the instruction fetched this cycle
+inline void trace_fetch(PipelineTraceRecord &record, uint8_t pc, uint8_t opcode)
+{
+    record.status |= TRACE_IF_VALID;
+    record.if_pc = pc;
+    record.opcodes |= (uint8_t)((opcode & 0x0F) << 4);
+}
+
+// Finish a cycle: write the record if the state changed
+inline void trace_end_cycle(PipelineTraceWriter &writer, uint64_t cycle, const PipelineTraceRecord &record)
+{
+    writer.cycles = cycle;
+    if (writer.records > 0 && record.status == writer.last.status && record.if_pc == writer.last.if_pc &&
+        record.ex_pc == writer.last.ex_pc && record.opcodes == writer.last.opcodes)
+        return;
+
+    if (writer.used + sizeof(PipelineTraceRecord) + 10 > PIPELINE_TRACE_BUFFER)
+        flush_pipeline_trace(writer);
+
+    uint64_t delta = cycle - writer.last_cycle;
+    uint8_t *p = writer.buffer + writer.used;
+    p[0] = record.status | (delta != 1 ? TRACE_DELTA : 0);
+    p[1] = record.if_pc;
+    p[2] = record.ex_pc;
+    p[3] = record.opcodes;
+    p += 4;
+    if (delta != 1)
+    {
+        do
+        {
+            uint8_t byte = delta & 0x7F;
+            delta >>= 7;
+            *p++ = byte | (delta ? 0x80 : 0);
+        } while (delta);
+    }
+
+    writer.used = p - writer.buffer;
+    writer.last = record;
+    writer.last_cycle = cycle;
+    writer.records++;
+}
+
+#endif // PIPELINE_TRACE_H
@@ -0,0 +1,166 @@
+#include "prefetcher.h"
+
+using namespace std;
+
+const int STRIDE_CONFIDENCE_MAX = 3;    // 2-bit saturating counter
+const int STRIDE_CONFIDENCE_ISSUE = 1;  // Prefetch once the stride has repeated
+const int STREAM_CONFIDENCE_ISSUE = 2;  // Adjacent blocks seen before a stream runs ahead
+
+// Forget all training
+void prefetcher_reset(PrefetcherState &state)
+{
+    for (int i = 0; i < PREFETCH_STRIDE_ENTRIES; i++)
+        state.stride[i].valid = false;
+    state.global_stride.valid = false;
+    for (int i = 0; i < PREFETCH_STREAMS; i++)
+        state.stream[i].valid = false;
+    state.clock = 0;
+}
+
+// Append block to blocks if it lies in the address space
+static void add_candidate(int block, int blocks[], int &count)
+{
+    if (block >= 0 && block < 256)
+        blocks[count++] = block;
+}
+
+// Train a stride entry on address; true once its stride is confident
+static bool train_stride(StrideEntry &entry, uint8_t pc, uint8_t address)
+{
+    if (!entry.valid || entry.pc != pc)
+    {
+        entry.valid = true;
+        entry.pc = pc;
+        entry.last_address = address;
+        entry.stride = 0;
+        entry.confidence = 0;
+        return false;
+    }
+
+    int stride = (int)address - (int)entry.last_address;
+    entry.last_address = address;
+    if (stride != 0 && stride == entry.stride)
+    {
+        if (entry.confidence < STRIDE_CONFIDENCE_MAX)
+            entry.confidence++;
+    }
+    else
+    {
+        if (entry.confidence > 0)
+            entry.confidence--;
+        if (entry.confidence == 0)
+            entry.stride = stride;
+    }
+    return entry.confidence >= STRIDE_CONFIDENCE_ISSUE;
+}
+
+// PC-indexed stride detection, falling back to the global load stream
+static int observe_stride(PrefetcherState &state, int block_size, uint8_t pc, uint8_t address, int blocks[])
+{
+    StrideEntry &entry = state.stride[pc % PREFETCH_STRIDE_ENTRIES];
+    bool local = train_stride(entry, pc, address);
+    bool global = train_stride(state.global_stride, 0, address);
+
+    int count = 0;
+    if (local)
+        add_candidate((address + entry.stride) & ~(block_size - 1), blocks, count);
+    else if (global)
+        add_candidate((address + state.global_stride.stride) & ~(block_size - 1), blocks, count);
+    return count;
+}
+
+// Sequential streams: an access to the block after (or before) a
+// stream's last block extends it; unmatched blocks start a new stream
+static int observe_stream(PrefetcherState &state, int block_size, uint8_t address, int blocks[])
+{
+    int block = address & ~(block_size - 1);
+    state.clock++;
+
+    for (int i = 0; i < PREFETCH_STREAMS; i++)
+    {
+        StreamEntry &stream = state.stream[i];
+        if (!stream.valid)
+            continue;
+        if (block == stream.last_block)
+        {
+            stream.last_use = state.clock;
+            return 0;
+        }
+
+        int direction = (block == stream.last_block + block_size) ? 1 :
+                        (block == stream.last_block - block_size) ? -1 : 0;
+        if (direction == 0 || (stream.direction != 0 && direction != stream.direction))
+            continue;
+
+        stream.direction = direction;
+        stream.last_block = block;
+        stream.last_use = state.clock;
+        if (stream.confidence < STREAM_CONFIDENCE_ISSUE)
+            stream.confidence++;
+
+        int count = 0;
+        if (stream.confidence >= STREAM_CONFIDENCE_ISSUE)
+            for (int k = 1; k <= PREFETCH_DEGREE; k++)
+                add_candidate(block + k * direction * block_size, blocks, count);
+        return count;
+    }
+
+    // Start a stream in the free or least recently used slot
+    int victim = 0;
+    for (int i = 0; i < PREFETCH_STREAMS; i++)
+    {
+        if (!state.stream[i].valid)
+        {
+            victim = i;
+            break;
+        }
+        if (state.stream[i].last_use < state.stream[victim].last_use)
+            victim = i;
+    }
+    StreamEntry &stream = state.stream[victim];
+    stream.valid = true;
+    stream.last_block = block;
+    stream.direction = 0;
+    stream.confidence = 1;
+    stream.last_use = state.clock;
+    return 0;
+}
+
+// Train on a demand load and return the blocks to prefetch
+int prefetcher_observe(PrefetcherState &state, PrefetchPolicy policy, int block_size,
+                       uint8_t pc, uint8_t address, int blocks[])
+{
+    int count = 0;
+    switch (policy)
+    {
+        case PREFETCH_NEXT_LINE:
+            add_candidate((address & ~(block_size - 1)) + block_size, blocks, count);
+            return count;
+        case PREFETCH_STRIDE:
+            return observe_stride(state, block_size, pc, address, blocks);
+        case PREFETCH_STREAM:
+            return observe_stream(state, block_size, address, blocks);
+        default:
+            return 0;
+    }
+}
+
+static const char *const prefetch_names[] = { "none", "next", "stride", "stream" };
+
+const char *prefetch_policy_name(PrefetchPolicy policy)
+{
+    return prefetch_names[policy];
+}
+
+bool parse_prefetch_policy(const string &name, PrefetchPolicy &policy)
+{
+    for (int i = PREFETCH_NONE; i <= PREFETCH_STREAM; i++)
+    {
+        if (name == prefetch_names[i])
+        {
+            policy = (PrefetchPolicy)i;
+            return true;
+        }
+    }
+    return false;
+}
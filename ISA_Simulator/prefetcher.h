@@ -0,0 +1,76 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/*
+     Data cache prefetchers
+     cache_read() hands every demand load to prefetcher_observe(), which
+     trains the selected prefetcher and returns the block addresses it
+     wants fetched. The cache issues them as asynchronous fills tagged as
+     prefetched (cache.cpp), so it can tell useful prefetches (first
+     demand use after the fill completed), late ones (demand use while
+     the fill was still in flight) and useless ones (never used).
+*/
+
+enum PrefetchPolicy
+{
+    PREFETCH_NONE,
+    PREFETCH_NEXT_LINE,     // Every access prefetches the following block
+    PREFETCH_STRIDE,        // PC-indexed stride table, plus one entry for the whole load stream
+    PREFETCH_STREAM         // Sequential stream tracker, runs PREFETCH_DEGREE blocks ahead
+};
+
+#define CACHE_PREFETCHER PREFETCH_NONE
+#define PREFETCH_DEGREE 2           // Blocks issued per confirmed stream access
+#define PREFETCH_STRIDE_ENTRIES 16  // Stride table entries (indexed by PC)
+#define PREFETCH_STREAMS 4          // Streams tracked at once
+#define MAX_PREFETCH_CANDIDATES PREFETCH_DEGREE
+
+// One stride table entry (2-bit confidence). LD/ST take absolute
+// addresses, so a PC only strides if its code is rewritten; the global
+// entry, trained on every load, catches unrolled array walks.
+struct StrideEntry
+{
+    bool valid;
+    uint8_t pc;
+    uint8_t last_address;
+    int stride;
+    int confidence;
+};
+
+// One stream: direction is +1/-1 once two adjacent blocks were seen
+struct StreamEntry
+{
+    bool valid;
+    int last_block;
+    int direction;
+    int confidence;
+    uint64_t last_use;      // LRU among streams
+};
+
+struct PrefetcherState
+{
+    StrideEntry stride[PREFETCH_STRIDE_ENTRIES];
+    StrideEntry global_stride;
+    StreamEntry stream[PREFETCH_STREAMS];
+    uint64_t clock;
+};
+
+// Forget all training
+void prefetcher_reset(PrefetcherState &state);
+
+// Train on a demand load of address by the instruction at pc. Writes up
+// to MAX_PREFETCH_CANDIDATES block addresses (within the 8-bit address
+// space) to blocks and returns how many.
+int prefetcher_observe(PrefetcherState &state, PrefetchPolicy policy, int block_size,
+                       uint8_t pc, uint8_t address, int blocks[]);
+
+// Policy names: none, next, stride, stream
+const char *prefetch_policy_name(PrefetchPolicy policy);
+bool parse_prefetch_policy(const string &name, PrefetchPolicy &policy);
+
+#endif // PREFETCHER_H
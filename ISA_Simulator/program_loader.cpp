@@ -0,0 +1,278 @@
+#include "program_loader.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Read-only view of a whole file
+struct MappedFile
+{
+    const char *data;
+    size_t size;
+#if defined(_WIN32)
+    vector<char> buffer;    // No mmap on MinGW: read the file once instead
+#endif
+};
+
+// Map a file read-only
+static bool map_file(const string &path, MappedFile &file)
+{
+    file.data = nullptr;
+    file.size = 0;
+
+#if defined(_WIN32)
+    ifstream in(path.c_str(), ios::binary | ios::ate);
+    if (!in.is_open())
+        return false;
+
+    file.size = (size_t)in.tellg();
+    file.buffer.resize(file.size);
+    in.seekg(0);
+    if (file.size > 0 && !in.read(&file.buffer[0], file.size))
+        return false;
+    file.data = file.size > 0 ? &file.buffer[0] : nullptr;
+    return true;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    file.size = (size_t)st.st_size;
+    if (file.size > 0)
+    {
+        void *addr = mmap(nullptr, file.size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+        file.data = (const char *)addr;
+    }
+
+    close(fd);  // The mapping stays valid after close
+    return true;
+#endif
+}
+
+// Release a mapping from map_file()
+static void unmap_file(MappedFile &file)
+{
+#if !defined(_WIN32)
+    if (file.data != nullptr)
+        munmap((void *)file.data, file.size);
+#endif
+    file.data = nullptr;
+    file.size = 0;
+}
+
+// Produce display text and mnemonic for a word
+void disassemble(InstructionWord word, string &instruction, string &mnemonic)
+{
+    uint8_t opcode = instruction_opcode(word);
+    int reg = instruction_register(word);
+    int data = instruction_data(word);
+    char text[32];
+
+    switch (opcode)
+    {
+        case 0x01: mnemonic = "ADD"; snprintf(text, sizeof(text), "ADD R%d", reg); break;
+        case 0x02: mnemonic = "SUB"; snprintf(text, sizeof(text), "SUB R%d", reg); break;
+        case 0x03: mnemonic = "MUL"; snprintf(text, sizeof(text), "MUL R%d", reg); break;
+        case 0x04: mnemonic = "DIV"; snprintf(text, sizeof(text), "DIV R%d", reg); break;
+        case 0x08:
+        case 0x0A: mnemonic = "JMP"; snprintf(text, sizeof(text), "JMP 0x%02X", data); break;
+        case 0x05: mnemonic = "BEQZ"; snprintf(text, sizeof(text), "BEQZ R%d, 0x%02X", reg, data); break;
+        case 0x06: mnemonic = "BNEZ"; snprintf(text, sizeof(text), "BNEZ R%d, 0x%02X", reg, data); break;
+        case 0x0D: mnemonic = "LD";  snprintf(text, sizeof(text), "LD R%d, %d", reg, data); break;
+        case 0x0E: mnemonic = "ST";  snprintf(text, sizeof(text), "ST R%d, %d", reg, data); break;
+        case 0x0F: mnemonic = "HLT"; snprintf(text, sizeof(text), "HALT"); break;
+        case 0x00: mnemonic = "DATA"; snprintf(text, sizeof(text), "DATA: 0x%02X", data); break;
+        default:   mnemonic = "UNK"; snprintf(text, sizeof(text), "UNKNOWN 0x%04X", word); break;
+    }
+
+    instruction = text;
+}
+
+// Reset the image and record one loaded word
+static void clear_image(ProgramImage &image)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        image.words[i] = 0;
+        image.text[i].instruction = "";
+        image.text[i].mnemonic = "";
+        image.text[i].valid = false;
+    }
+    image.length = 0;
+    image.image_words = 0;
+}
+
+static void append_word(ProgramImage &image, InstructionWord word)
+{
+    if (image.length < 256)
+    {
+        size_t i = image.length++;
+        image.words[i] = word;
+        disassemble(word, image.text[i].instruction, image.text[i].mnemonic);
+        image.text[i].valid = true;
+    }
+    image.image_words++;
+}
+
+static void warn_if_truncated(const string &path, const ProgramImage &image)
+{
+    if (image.image_words > image.length)
+        cerr << "Warning: " << path << " holds " << image.image_words
+             << " words; only the first 256 fit instruction memory" << endl;
+}
+
+// An image without a single instruction word is an error, not a
+// program of zero words
+static bool check_not_empty(const string &path, const ProgramImage &image)
+{
+    if (image.image_words > 0)
+        return true;
+    cerr << "Error: " << path << " holds no instruction words" << endl;
+    return false;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Load a program.hex style text image
+bool load_hex_program(const string &path, ProgramImage &image)
+{
+    MappedFile file;
+    if (!map_file(path, file))
+    {
+        cerr << "Error: Could not open program " << path << endl;
+        return false;
+    }
+
+    clear_image(image);
+
+    const char *p = file.data;
+    const char *end = file.data + file.size;
+    int line = 1;
+    bool ok = true;
+
+    while (p < end && ok)
+    {
+        // Collect up to two hex tokens on this line
+        unsigned int tokens[2];
+        int token_digits[2];
+        int count = 0;
+        bool comment = false;
+
+        while (p < end && *p != '\n')
+        {
+            char c = *p;
+            if (c == '#' || c == ';')
+                comment = true;
+
+            if (comment || c == ' ' || c == '\t' || c == '\r')
+            {
+                p++;
+                continue;
+            }
+
+            unsigned int value = 0;
+            int digits = 0;
+            while (p < end && hex_digit(*p) >= 0)
+            {
+                value = (value << 4) | hex_digit(*p);
+                digits++;
+                p++;
+            }
+
+            if (digits == 0 || count == 2 || digits > 4)
+            {
+                ok = false;
+                break;
+            }
+            tokens[count] = value;
+            token_digits[count] = digits;
+            count++;
+        }
+
+        if (ok && count == 2 && token_digits[0] <= 2 && token_digits[1] <= 2)
+            append_word(image, (InstructionWord)((tokens[0] << 8) | tokens[1]));  // "HI LO"
+        else if (ok && count == 1 && token_digits[0] > 2)
+            append_word(image, (InstructionWord)tokens[0]);                       // "HILO"
+        else if (ok && count != 0)
+            ok = false;
+
+        if (!ok)
+            cerr << "Error: " << path << ":" << line << ": expected one instruction word" << endl;
+
+        if (p < end)
+            p++;  // Skip '\n'
+        line++;
+    }
+
+    unmap_file(file);
+
+    if (ok)
+        ok = check_not_empty(path, image);
+    if (ok)
+        warn_if_truncated(path, image);
+    return ok;
+}
+
+// Load a raw binary image
+bool load_binary_image(const string &path, ProgramImage &image)
+{
+    MappedFile file;
+    if (!map_file(path, file))
+    {
+        cerr << "Error: Could not open image " << path << endl;
+        return false;
+    }
+
+    clear_image(image);
+
+    // Only the words that fit are touched, so a large image costs no
+    // more than its first 512 bytes
+    const unsigned char *bytes = (const unsigned char *)file.data;
+    size_t words = file.size / 2;
+    size_t loaded = words < 256 ? words : 256;
+
+    for (size_t i = 0; i < loaded; i++)
+        append_word(image, (InstructionWord)(bytes[2 * i] | (bytes[2 * i + 1] << 8)));
+    image.image_words = words;
+
+    bool ok = (file.size % 2 == 0);
+    if (!ok)
+        cerr << "Error: " << path << " has an odd number of bytes" << endl;
+
+    unmap_file(file);
+
+    if (ok)
+        ok = check_not_empty(path, image);
+    if (ok)
+        warn_if_truncated(path, image);
+    return ok;
+}
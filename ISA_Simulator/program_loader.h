@@ -0,0 +1,40 @@
+#ifndef PROGRAM_LOADER_H
+#define PROGRAM_LOADER_H
+
+#include <cstddef>
+#include <string>
+#include "instruction_memory.h"
+
+using namespace std;
+
+// Program Loader
+// Loads a program image once; every SimulatorContext that points at it
+// copies the words into its own instruction memory in initialize_memory().
+//
+// Hex format (program.hex): one InstructionWord per line as two hex bytes,
+//      D1 0A        ; LD R1, 10   ->  [opcode D | register 1 | data 0A]
+// Blank lines and text after '#' or ';' are ignored.
+//
+// Binary format: raw little-endian 16-bit InstructionWords from address 0.
+//
+// Both files are memory-mapped and parsed in place. Only the first 256
+// words fit the 8-bit PC; longer images are truncated with a warning.
+
+struct ProgramImage
+{
+    InstructionWord words[256];     // Packed instruction memory image
+    InstructionText text[256];      // Disassembly for display/logging
+    size_t length;                  // Words loaded (<= 256)
+    size_t image_words;             // Words present in the source file
+};
+
+// Load a program.hex style text image (false on a syntax error or no words)
+bool load_hex_program(const string &path, ProgramImage &image);
+
+// Load a raw binary image (false on an odd byte count or an empty file)
+bool load_binary_image(const string &path, ProgramImage &image);
+
+// Produce display text ("LD R1, 10") and mnemonic ("LD") for a word
+void disassemble(InstructionWord word, string &instruction, string &mnemonic);
+
+#endif // PROGRAM_LOADER_H
@@ -6,25 +6,21 @@
 
 using namespace std;
 
-// Register File: R0-R15 (16 registers, 8-bit each)
-extern uint8_t register_file[16];
+struct SimulatorContext;
 
-// Special Registers
-extern uint8_t MAR;  // Memory Address Register
-extern uint8_t MDR;  // Memory Data Register
-extern uint8_t PC;   // Program Counter
-extern bool halt_flag;  // Halt flag
+// Register File: R0-R15 (16 registers, 8-bit each) and the special
+// registers (MAR, MDR, PC, halt flag) live in SimulatorContext.
 
 // Initialize all registers to 0
-void initialize_registers();
+void initialize_registers(SimulatorContext &ctx);
 
 // Read from register file
-uint8_t read_register(uint8_t reg_num);
+uint8_t read_register(SimulatorContext &ctx, uint8_t reg_num);
 
 // Write to register file
-void write_register(uint8_t reg_num, uint8_t value);
+void write_register(SimulatorContext &ctx, uint8_t reg_num, uint8_t value);
 
 // Display all register contents
-void display_registers();
+void display_registers(SimulatorContext &ctx);
 
 #endif // REGISTERS_H
@@ -0,0 +1,344 @@
+#include "sampling.h"
+#include "simulator_context.h"
+#include "instruction_memory.h"
+#include "data_memory.h"
+#include "registers.h"
+#include "pipeline.h"
+#include "functional.h"
+#include "thread_pool.h"
+#include <cstring>
+#include <ostream>
+#include <random>
+
+using namespace std;
+
+// Basic-block vector for one interval, stored sparsely:
+// (block start PC, instructions executed in that block)
+struct IntervalProfile
+{
+    vector<pair<uint8_t, double> > blocks;  // Normalized to sum to 1
+    uint64_t length;                        // Instructions in the interval
+};
+
+// Defaults: 1000-instruction intervals, up to 4 points, 1M instruction
+// bound, and the compiled-in cache and pipeline configuration
+SamplingSpec default_sampling_spec()
+{
+    SamplingSpec spec;
+    spec.interval = 1000;
+    spec.clusters = 4;
+    spec.max_instructions = 1000000;
+    CacheConfig cache = { CACHE_LINES, CACHE_HIT_CYCLES, CACHE_MISS_PENALTY,
+                          CACHE_WAYS, CACHE_BLOCK_SIZE, CACHE_REPLACEMENT,
+                          CACHE_WRITE_POLICY, CACHE_WRITE_BUFFER, CACHE_MSHRS,
+                          CACHE_PREFETCHER, VICTIM_LINES, VICTIM_SWAP_CYCLES };
+    CacheConfig icache = { ICACHE_LINES, CACHE_HIT_CYCLES, CACHE_MISS_PENALTY,
+                           CACHE_WAYS, CACHE_BLOCK_SIZE, CACHE_REPLACEMENT,
+                           CACHE_WRITE_POLICY, CACHE_WRITE_BUFFER, CACHE_MSHRS, PREFETCH_NONE,
+                           0, VICTIM_SWAP_CYCLES };
+    spec.cache = cache;
+    spec.hierarchy.lower_levels = 0;
+    spec.icache = icache;
+    spec.pipeline_depth = PIPELINE_DEPTH;
+    spec.issue_width = ISSUE_WIDTH;
+    spec.predictor = BRANCH_PREDICTOR;
+    return spec;
+}
+
+// Close the current interval: move the touched counters into a profile
+static void flush_interval(uint32_t counts[256], vector<uint8_t> &touched,
+                           uint64_t length, vector<IntervalProfile> &profiles)
+{
+    IntervalProfile profile;
+    profile.length = length;
+    for (size_t i = 0; i < touched.size(); i++)
+    {
+        uint8_t block = touched[i];
+        profile.blocks.push_back(make_pair(block, (double)counts[block] / length));
+        counts[block] = 0;
+    }
+    touched.clear();
+    profiles.push_back(profile);
+}
+
+// Run the program functionally and collect one BBV per interval
+static void profile_program(const SamplingSpec &spec, const ProgramImage *program,
+                            vector<IntervalProfile> &profiles)
+{
+    ostream discard(nullptr);
+    SimulatorContext *ctx = new SimulatorContext;
+    ctx->out = &discard;
+    ctx->program = program;
+    
+    initialize_data_memory(*ctx);
+    initialize_registers(*ctx);
+    initialize_memory(*ctx);
+    predecode_program(*ctx);
+    
+    // Block leaders: program entry, every jump's resume address, every
+    // branch target, and the instruction after each jump or branch
+    bool leader[256];
+    memset(leader, 0, sizeof(leader));
+    leader[0] = true;
+    for (int pc = 0; pc < 256; pc++)
+    {
+        const DecodedInstruction &inst = ctx->decoded_program[pc];
+        if (!(inst.flags & DECODE_VALID))
+            continue;
+        if (inst.flags & DECODE_JUMP)
+            leader[(uint8_t)(inst.address_data + 1)] = true;
+        else if (inst.flags & DECODE_BRANCH)
+            leader[inst.address_data] = true;
+        else
+            continue;
+        leader[(uint8_t)(pc + 1)] = true;
+    }
+    
+    uint32_t counts[256];
+    memset(counts, 0, sizeof(counts));
+    vector<uint8_t> touched;
+    uint8_t block = ctx->PC;
+    uint64_t in_interval = 0;
+    uint64_t executed = 0;
+    
+    while (!ctx->halt_flag && executed < spec.max_instructions)
+    {
+        if (leader[ctx->PC])
+            block = ctx->PC;
+        if (counts[block]++ == 0)
+            touched.push_back(block);
+        
+        functional_step(*ctx);
+        executed++;
+        
+        if (++in_interval == spec.interval)
+        {
+            flush_interval(counts, touched, in_interval, profiles);
+            in_interval = 0;
+        }
+    }
+    
+    if (in_interval > 0)
+        flush_interval(counts, touched, in_interval, profiles);
+    
+    delete ctx;
+}
+
+// Squared distance between a sparse BBV and a dense centroid
+static double distance_to(const IntervalProfile &p, const vector<double> &centroid, double centroid_norm)
+{
+    double dist = centroid_norm;
+    for (size_t i = 0; i < p.blocks.size(); i++)
+    {
+        double x = p.blocks[i].second;
+        dist += x * x - 2 * x * centroid[p.blocks[i].first];
+    }
+    return dist;
+}
+
+static double squared_norm(const vector<double> &v)
+{
+    double norm = 0;
+    for (size_t i = 0; i < v.size(); i++)
+        norm += v[i] * v[i];
+    return norm;
+}
+
+// k-means over the BBVs; fills assignment[] and returns the centroids.
+// Seeded with k-means++ from a fixed seed so runs are reproducible.
+static vector<vector<double> > cluster_intervals(const vector<IntervalProfile> &profiles,
+                                                int k, vector<int> &assignment)
+{
+    size_t n = profiles.size();
+    vector<vector<double> > centroids;
+    mt19937 rng(12345);
+    
+    // k-means++ seeding
+    vector<double> nearest(n, 1e300);
+    size_t first = rng() % n;
+    while ((int)centroids.size() < k)
+    {
+        size_t chosen = first;
+        if (!centroids.empty())
+        {
+            double total = 0;
+            for (size_t i = 0; i < n; i++)
+                total += nearest[i];
+            if (total <= 0)
+                break;  // Fewer distinct vectors than k
+            
+            double target = uniform_real_distribution<double>(0, total)(rng);
+            for (chosen = 0; chosen + 1 < n; chosen++)
+            {
+                target -= nearest[chosen];
+                if (target <= 0)
+                    break;
+            }
+        }
+        
+        vector<double> c(256, 0.0);
+        for (size_t b = 0; b < profiles[chosen].blocks.size(); b++)
+            c[profiles[chosen].blocks[b].first] = profiles[chosen].blocks[b].second;
+        double c_norm = squared_norm(c);
+        for (size_t i = 0; i < n; i++)
+        {
+            double d = distance_to(profiles[i], c, c_norm);
+            if (d < nearest[i])
+                nearest[i] = d < 0 ? 0 : d;
+        }
+        centroids.push_back(c);
+    }
+    
+    // Lloyd iterations
+    assignment.assign(n, -1);
+    for (int iter = 0; iter < 100; iter++)
+    {
+        bool changed = false;
+        vector<double> norms(centroids.size());
+        for (size_t c = 0; c < centroids.size(); c++)
+            norms[c] = squared_norm(centroids[c]);
+        
+        for (size_t i = 0; i < n; i++)
+        {
+            int best = 0;
+            double best_dist = distance_to(profiles[i], centroids[0], norms[0]);
+            for (size_t c = 1; c < centroids.size(); c++)
+            {
+                double d = distance_to(profiles[i], centroids[c], norms[c]);
+                if (d < best_dist)
+                {
+                    best = (int)c;
+                    best_dist = d;
+                }
+            }
+            if (assignment[i] != best)
+            {
+                assignment[i] = best;
+                changed = true;
+            }
+        }
+        
+        if (!changed)
+            break;
+        
+        // Recompute centroids as member means
+        vector<size_t> members(centroids.size(), 0);
+        for (size_t c = 0; c < centroids.size(); c++)
+            centroids[c].assign(256, 0.0);
+        for (size_t i = 0; i < n; i++)
+        {
+            members[assignment[i]]++;
+            for (size_t b = 0; b < profiles[i].blocks.size(); b++)
+                centroids[assignment[i]][profiles[i].blocks[b].first] += profiles[i].blocks[b].second;
+        }
+        for (size_t c = 0; c < centroids.size(); c++)
+            for (int b = 0; members[c] > 0 && b < 256; b++)
+                centroids[c][b] /= members[c];
+    }
+    
+    return centroids;
+}
+
+// Profile, cluster and simulate the chosen points
+bool run_sampled_simulation(const SamplingSpec &spec, const ProgramImage *program,
+                            bool use_forwarding, bool use_cache, unsigned int jobs,
+                            SamplingResult &result)
+{
+    vector<IntervalProfile> profiles;
+    profile_program(spec, program, profiles);
+    if (profiles.empty())
+        return false;
+    
+    result.intervals = profiles.size();
+    result.total_instructions = 0;
+    vector<uint64_t> starts(profiles.size());
+    for (size_t i = 0; i < profiles.size(); i++)
+    {
+        starts[i] = result.total_instructions;
+        result.total_instructions += profiles[i].length;
+    }
+    
+    vector<int> assignment;
+    vector<vector<double> > centroids = cluster_intervals(profiles, spec.clusters, assignment);
+    
+    // Representative per cluster: the member closest to the centroid
+    result.points.clear();
+    for (size_t c = 0; c < centroids.size(); c++)
+    {
+        double norm = squared_norm(centroids[c]);
+        uint64_t cluster_instructions = 0;
+        size_t best = profiles.size();
+        double best_dist = 0;
+        for (size_t i = 0; i < profiles.size(); i++)
+        {
+            if (assignment[i] != (int)c)
+                continue;
+            cluster_instructions += profiles[i].length;
+            double d = distance_to(profiles[i], centroids[c], norm);
+            if (best == profiles.size() || d < best_dist)
+            {
+                best = i;
+                best_dist = d;
+            }
+        }
+        if (best == profiles.size())
+            continue;  // Empty cluster
+        
+        SimulationPoint point;
+        point.interval_index = best;
+        point.start = starts[best];
+        point.weight = (double)cluster_instructions / result.total_instructions;
+        result.points.push_back(point);
+    }
+    
+    // Detailed simulation of each point
+    {
+        ThreadPool pool(jobs);
+        for (size_t i = 0; i < result.points.size(); i++)
+        {
+            SimulationPoint *point = &result.points[i];
+            uint64_t length = profiles[point->interval_index].length;
+            pool.submit([point, length, &spec, program, use_forwarding, use_cache]() {
+                ostream discard(nullptr);
+                SimulatorContext *ctx = new SimulatorContext;
+                ctx->out = &discard;
+                ctx->program = program;
+                ctx->cache_config = spec.cache;
+                ctx->hierarchy_config = spec.hierarchy;
+                ctx->icache_config = spec.icache;
+                ctx->pipeline_depth = spec.pipeline_depth;
+                ctx->issue_width = spec.issue_width;
+                ctx->branch_predictor = spec.predictor;
+                ctx->fast_forward.instructions = point->start;
+                ctx->detail_instructions = length;
+                ctx->max_cycles = UINT64_MAX;  // detail_instructions bounds the run
+                
+                point->result = run_simulation(*ctx, use_forwarding, use_cache, false);
+                delete ctx;
+            });
+        }
+        pool.wait_all();
+    }
+    
+    // Weight per-instruction rates into whole-program estimates
+    result.detailed_instructions = 0;
+    result.cycles = result.stalls = result.forwardings = 0;
+    result.cache_hits = result.cache_misses = 0;
+    for (size_t i = 0; i < result.points.size(); i++)
+    {
+        const SimulationResult &r = result.points[i].result;
+        result.detailed_instructions += r.instructions;
+        if (r.instructions == 0)
+            continue;
+        
+        double scale = result.points[i].weight * result.total_instructions / r.instructions;
+        result.cycles += scale * r.cycles;
+        result.stalls += scale * r.stalls;
+        result.forwardings += scale * r.forwardings;
+        result.cache_hits += scale * r.cache_hits;
+        result.cache_misses += scale * r.cache_misses;
+    }
+    result.cpi = result.cycles / result.total_instructions;
+    
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "simulator.h"
+#include "cache.h"
+#include "pipeline.h"
+#include "branch_predictor.h"
+
+using namespace std;
+
+struct ProgramImage;
+
+// Sampled Simulation (SimPoint-style)
+// 1. Profile: run the program functionally and record a basic-block
+//    vector (instructions executed per basic block) for every interval
+//    of `interval` instructions.
+// 2. Cluster the normalized vectors with k-means and pick, per cluster,
+//    the interval closest to its centroid as the simulation point.
+// 3. Fast-forward to each simulation point and run only that interval
+//    through the detailed pipeline (on the ThreadPool), then weight the
+//    per-instruction results by cluster size into whole-program
+//    estimates.
+// Each simulation point starts with a cold cache and an empty pipeline.
+
+// Sampling parameters
+struct SamplingSpec
+{
+    uint64_t interval;          // Instructions per interval
+    int clusters;               // Maximum number of simulation points (k)
+    uint64_t max_instructions;  // Profile length bound for programs that never HALT
+
+    // Detailed configuration of every simulation point
+    CacheConfig cache;
+    CacheHierarchyConfig hierarchy;
+    CacheConfig icache;                 // lines 0 = no I-cache
+    int pipeline_depth;
+    int issue_width;
+    BranchPredictorKind predictor;
+};
+
+// One representative interval
+struct SimulationPoint
+{
+    size_t interval_index;      // Interval number in program order
+    uint64_t start;             // Instructions executed before the interval
+    double weight;              // Fraction of all instructions it represents
+    SimulationResult result;    // Detailed result for the interval
+};
+
+// Whole-program estimate
+struct SamplingResult
+{
+    uint64_t total_instructions;    // Instructions in the profiled run
+    size_t intervals;               // Intervals profiled
+    uint64_t detailed_instructions; // Instructions simulated in detail
+    vector<SimulationPoint> points;
+
+    // Weighted estimates
+    double cpi;
+    double cycles;
+    double stalls;
+    double forwardings;
+    double cache_hits;
+    double cache_misses;
+};
+
+// Defaults: 1000-instruction intervals, up to 4 points, 1M instruction
+// bound, and the compiled-in cache and pipeline configuration
+SamplingSpec default_sampling_spec();
+
+// Profile, cluster and simulate the chosen points on `jobs` workers
+// (0 = one per hardware thread). program may be nullptr for the
+// built-in test program. Returns false if the program executes nothing.
+bool run_sampled_simulation(const SamplingSpec &spec, const ProgramImage *program,
+                            bool use_forwarding, bool use_cache, unsigned int jobs,
+                            SamplingResult &result);
+
+#endif // SAMPLING_H
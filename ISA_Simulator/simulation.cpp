@@ -0,0 +1,1067 @@
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include "simulator.h"
+#include "simulator_context.h"
+#include "instruction_memory.h"
+#include "data_memory.h"
+#include "registers.h"
+#include "pipeline.h"
+#include "performance.h"
+#include "cache.h"
+#include "functional.h"
+#include "trace_policy.h"
+#include "pipeline_trace.h"
+#include "perfetto_trace.h"
+#include "memory_trace.h"
+
+using namespace std;
+
+// Print results in exact format required by assignment (to ctx.out)
+void print_results(SimulatorContext &ctx)
+{
+    char cpi[32];
+    snprintf(cpi, sizeof(cpi), "%.2f", calculate_cpi(ctx));
+    
+    *ctx.out << "\nProgram finished." << endl;
+    *ctx.out << "Cycles = " << ctx.cycle_count << endl;
+    *ctx.out << "Instructions = " << ctx.instruction_count << endl;
+    *ctx.out << "CPI = " << cpi << endl;
+    if (ctx.issue_width > 1) {
+        char ipc[32];
+        snprintf(ipc, sizeof(ipc), "%.2f", calculate_ipc(ctx));
+        *ctx.out << "IPC = " << ipc << endl;
+    }
+    *ctx.out << "Stalls = " << (ctx.stall_count + ctx.cache_stall_cycles + ctx.icache_stall_cycles) << endl;
+    *ctx.out << "Forwardings = " << ctx.forwarding_count << endl;
+    *ctx.out << "Cache hits = " << ctx.cache_hits << endl;
+    *ctx.out << "Cache misses = " << ctx.cache_misses << endl;
+    if (ctx.icache_config.lines > 0) {
+        *ctx.out << "I-cache hits = " << ctx.icache_hits << endl;
+        *ctx.out << "I-cache misses = " << ctx.icache_misses << endl;
+    }
+}
+
+// Hand a finished cycle to the binary and Perfetto trace writers
+static void end_trace_cycle(SimulatorContext &ctx, const PipelineTraceRecord &record)
+{
+    if (ctx.trace)
+        trace_end_cycle(*ctx.trace, ctx.cycle_count, record);
+    if (ctx.perfetto)
+        perfetto_cycle(*ctx.perfetto, ctx.cycle_count, record);
+}
+
+// Non-blocking cache: true once the source registers of the EX
+// instruction no longer wait on an outstanding load
+static bool operands_ready(const SimulatorContext &ctx)
+{
+    uint8_t reg = ctx.ifex_reg.operand;
+    switch (ctx.ifex_reg.opcode)
+    {
+        case 0x01: // ADD, SUB, MUL, DIV read R and R+1
+        case 0x02:
+        case 0x03:
+        case 0x04:
+            return ctx.reg_ready[reg] <= ctx.cycle_count && ctx.reg_ready[(reg + 1) % 16] <= ctx.cycle_count;
+        case 0x0E: // ST, BEQZ, BNEZ read R
+        case 0x05:
+        case 0x06:
+            return ctx.reg_ready[reg] <= ctx.cycle_count;
+        default:
+            return true;
+    }
+}
+
+// EX: where the instruction really continues, checked against the
+// next PC fetch predicted for it. Trains the predictor on JMPs and
+// branches and flushes the wrong-path fetches on a mispredict.
+template <class Trace>
+static void resolve_control_flow(SimulatorContext &ctx, uint8_t pc, uint8_t opcode, uint8_t reg,
+                                 uint8_t data, const BranchPrediction &prediction)
+{
+    bool branch = true, conditional = false, taken = true;
+    uint8_t target = data;
+    switch (opcode)
+    {
+        case 0x08: // JMP resumes at target + 1 (the IF/EX model skips the flushed slot)
+        case 0x0A:
+            target = data + 1;
+            break;
+        case 0x05: // BEQZ
+            conditional = true;
+            taken = read_register(ctx, reg) == 0;
+            break;
+        case 0x06: // BNEZ
+            conditional = true;
+            taken = read_register(ctx, reg) != 0;
+            break;
+        default:
+            branch = false;
+            taken = false;
+            break;
+    }
+    
+    uint8_t next_pc = taken ? target : pc + 1;
+    if (branch)
+    {
+        ctx.branch_count++;
+        branch_update(ctx.branch_state, ctx.branch_predictor, pc, conditional, taken, target, prediction);
+    }
+    if (next_pc == prediction.next_pc)
+        return;
+    
+    if (branch)
+        ctx.branch_mispredicts++;
+    else
+        branch_forget(ctx.branch_state, pc);
+    if (Trace::enabled) {
+        *ctx.out << "  [BRANCH] Mispredicted: fetched 0x" << hex << setw(2) << setfill('0')
+             << (int)prediction.next_pc << ", continuing at 0x" << setw(2) << (int)next_pc
+             << dec << setfill(' ') << endl;
+    }
+    ctx.PC = next_pc;
+    flush_pipeline<Trace>(ctx);
+}
+
+// Two-stage IF/EX loop (pipeline_depth 2): EX executes, accesses
+// memory and writes back in one cycle
+template <class Trace>
+static void run_ifex_pipeline(SimulatorContext &ctx, bool use_forwarding, bool use_cache)
+{
+    uint64_t cycle = 1;
+    bool tracing = (ctx.trace != nullptr || ctx.perfetto != nullptr);
+    bool use_icache = use_cache && ctx.icache_config.lines > 0;
+    bool nonblocking = use_cache && ctx.cache_config.mshrs > 0;
+    
+    while (!ctx.halt_flag && cycle <= ctx.max_cycles &&
+           (ctx.detail_instructions == 0 || ctx.instruction_count < ctx.detail_instructions))
+    {
+        if (Trace::enabled) {
+            *ctx.out << "--- CYCLE " << setw(3) << cycle << " ---" << endl;
+        }
+        
+        // Increment cycle counter
+        increment_cycle(ctx);
+        
+        // Trace record for this cycle (EX as it enters the cycle)
+        PipelineTraceRecord trace_record = { 0, 0, 0, 0 };
+        if (tracing) {
+            trace_begin_cycle(ctx, trace_record);
+        }
+        
+        // Check for cache stall remaining (only if cache enabled)
+        if (use_cache && ctx.cache_stall_remaining > 0)
+        {
+            if (Trace::enabled) {
+                *ctx.out << "  [CACHE] Stalling: " << ctx.cache_stall_remaining << " cycles remaining" << endl;
+            }
+            ctx.cache_stall_remaining--;
+            if (tracing) {
+                trace_record.status |= TRACE_CACHE_STALL;
+                end_trace_cycle(ctx, trace_record);
+            }
+            cycle++;
+            continue;
+        }
+        
+        // Non-blocking cache: misses no longer freeze the pipeline; an
+        // instruction waits in EX only while a register it reads is
+        // still being loaded
+        if (nonblocking && ctx.ifex_reg.valid && !ctx.ifex_reg.executed && !operands_ready(ctx))
+        {
+            if (Trace::enabled) {
+                *ctx.out << "  [MSHR] " << ctx.ifex_reg.mnemonic << " waiting on an outstanding load" << endl;
+            }
+            ctx.mshr_dependency_stalls++;
+            ctx.cache_stall_cycles++;
+            if (tracing) {
+                trace_record.status |= TRACE_CACHE_STALL;
+                end_trace_cycle(ctx, trace_record);
+            }
+            cycle++;
+            continue;
+        }
+        
+        // Execute current EX stage instruction (once; after a cache stall
+        // drains the instruction has already completed)
+        if (ctx.ifex_reg.valid && !ctx.ifex_reg.executed)
+        {
+            if (Trace::enabled) {
+                *ctx.out << "  [EX] Executing: " << ctx.ifex_reg.mnemonic << endl;
+            }
+            
+            uint8_t opcode = ctx.ifex_reg.opcode;
+            uint8_t reg = ctx.ifex_reg.operand;
+            uint8_t data = ctx.ifex_reg.address_data;
+            
+            // Reset result fields
+            ctx.ifex_reg.produces_result = false;
+            ctx.ifex_reg.result_ready = false;
+            ctx.ifex_reg.executed = true;
+            
+            switch (opcode)
+            {
+                case 0x01: // ADD
+                {
+                    uint8_t val1 = read_register(ctx, reg);
+                    uint8_t val2 = read_register(ctx, (reg + 1) % 16);
+                    uint8_t res = val1 + val2;
+                    write_register(ctx, reg, res);
+                    ctx.ifex_reg.produces_result = true;
+                    ctx.ifex_reg.result_value = res;
+                    ctx.ifex_reg.result_ready = true;
+                    ctx.ifex_reg.dest_reg = reg;
+                    increment_instruction(ctx);
+                    break;
+                }
+                case 0x02: // SUB
+                {
+                    uint8_t val1 = read_register(ctx, reg);
+                    uint8_t val2 = read_register(ctx, (reg + 1) % 16);
+                    uint8_t res = val1 - val2;
+                    write_register(ctx, reg, res);
+                    ctx.ifex_reg.produces_result = true;
+                    ctx.ifex_reg.result_value = res;
+                    ctx.ifex_reg.result_ready = true;
+                    ctx.ifex_reg.dest_reg = reg;
+                    increment_instruction(ctx);
+                    break;
+                }
+                case 0x03: // MUL
+                {
+                    uint8_t val1 = read_register(ctx, reg);
+                    uint8_t val2 = read_register(ctx, (reg + 1) % 16);
+                    uint8_t res = val1 * val2;
+                    write_register(ctx, reg, res);
+                    ctx.ifex_reg.produces_result = true;
+                    ctx.ifex_reg.result_value = res;
+                    ctx.ifex_reg.result_ready = true;
+                    ctx.ifex_reg.dest_reg = reg;
+                    increment_instruction(ctx);
+                    break;
+                }
+                case 0x04: // DIV
+                {
+                    uint8_t val1 = read_register(ctx, reg);
+                    uint8_t val2 = read_register(ctx, (reg + 1) % 16);
+                    if (val2 != 0) {
+                        uint8_t res = val1 / val2;
+                        write_register(ctx, reg, res);
+                        ctx.ifex_reg.produces_result = true;
+                        ctx.ifex_reg.result_value = res;
+                        ctx.ifex_reg.result_ready = true;
+                        ctx.ifex_reg.dest_reg = reg;
+                    }
+                    increment_instruction(ctx);
+                    break;
+                }
+                case 0x0D: // LD
+                {
+                    ctx.MAR = data;
+                    if (ctx.mem_trace) {
+                        memory_trace_access(*ctx.mem_trace, ctx.instruction_count, ctx.ifex_reg.pc, ctx.MAR, false);
+                    }
+                    if (use_cache) {
+                        bool hit;
+                        int stall_cycles, pending_cycles;
+                        ctx.MDR = cache_read<Trace>(ctx, ctx.ifex_reg.pc, ctx.MAR, hit, stall_cycles, pending_cycles);
+                        if (stall_cycles > 0) {
+                            ctx.cache_stall_remaining = stall_cycles;
+                        }
+                        ctx.reg_ready[reg] = ctx.cycle_count + pending_cycles + 1;
+                        if (ctx.perfetto) {
+                            perfetto_cache_access(*ctx.perfetto, ctx.cycle_count, ctx.ifex_reg.pc,
+                                                  ctx.MAR, false, hit, stall_cycles);
+                        }
+                    } else {
+                        // Direct memory access (no cache)
+                        ctx.MDR = read_data_memory(ctx, ctx.MAR);
+                    }
+                    write_register(ctx, reg, ctx.MDR);
+                    ctx.ifex_reg.produces_result = true;
+                    ctx.ifex_reg.result_value = ctx.MDR;
+                    ctx.ifex_reg.result_ready = true;
+                    ctx.ifex_reg.dest_reg = reg;
+                    increment_instruction(ctx);
+                    break;
+                }
+                case 0x0E: // ST
+                {
+                    ctx.MAR = data;
+                    ctx.MDR = read_register(ctx, reg);
+                    if (ctx.mem_trace) {
+                        memory_trace_access(*ctx.mem_trace, ctx.instruction_count, ctx.ifex_reg.pc, ctx.MAR, true);
+                    }
+                    if (use_cache) {
+                        uint64_t hits_before = ctx.cache_hits;
+                        int stall_cycles = cache_write<Trace>(ctx, ctx.MAR, ctx.MDR);
+                        if (stall_cycles > 0) {
+                            ctx.cache_stall_remaining = stall_cycles;
+                        }
+                        if (ctx.perfetto) {
+                            perfetto_cache_access(*ctx.perfetto, ctx.cycle_count, ctx.ifex_reg.pc,
+                                                  ctx.MAR, true, ctx.cache_hits != hits_before, stall_cycles);
+                        }
+                    } else {
+                        write_data_memory(ctx, ctx.MAR, ctx.MDR);
+                    }
+                    increment_instruction(ctx);
+                    break;
+                }
+                case 0x0F: // HALT
+                {
+                    ctx.halt_flag = true;
+                    increment_instruction(ctx);
+                    break;
+                }
+                default: // JMP and branches resolve below
+                    increment_instruction(ctx);
+                    break;
+            }
+            
+            if (!ctx.halt_flag) {
+                resolve_control_flow<Trace>(ctx, ctx.ifex_reg.pc, opcode, reg, data, ctx.ifex_reg.prediction);
+            }
+        }
+        
+        if (tracing && ctx.halt_flag) {
+            trace_record.status |= TRACE_HALT;
+        }
+        
+        // Check if cache caused a stall
+        if (use_cache && ctx.cache_stall_remaining > 0)
+        {
+            if (tracing) {
+                trace_record.status |= TRACE_CACHE_STALL;
+                end_trace_cycle(ctx, trace_record);
+            }
+            cycle++;
+            continue;
+        }
+        
+        // Check for hazards (detect_hazard_or_forward from professor's code)
+        bool need_stall = false;
+        if (ctx.ifex_reg.valid && ctx.ifex_reg.is_load && ctx.PC < 256)
+        {
+            const DecodedInstruction &if_inst = decode_instruction(ctx, ctx.PC);
+            if (if_inst.operand == ctx.ifex_reg.dest_reg)
+            {
+                if (use_forwarding && ctx.ifex_reg.result_ready)
+                {
+                    // Forwarding available - no stall
+                    if (Trace::enabled) {
+                        *ctx.out << "  [FORWARDING] R" << (int)ctx.ifex_reg.dest_reg 
+                             << " forwarded (hazard avoided)" << endl;
+                    }
+                    increment_forwarding(ctx);
+                    if (tracing) {
+                        trace_record.status |= TRACE_FORWARD;
+                    }
+                }
+                else
+                {
+                    // No forwarding - must stall
+                    if (Trace::enabled) {
+                        *ctx.out << "  [HAZARD] Load-Use detected - STALL" << endl;
+                    }
+                    need_stall = true;
+                    increment_stall(ctx);
+                }
+            }
+        }
+        
+        if (need_stall)
+        {
+            ctx.ifex_reg.valid = false;
+            ctx.ifex_reg.mnemonic = "BUBBLE";
+            if (tracing) {
+                trace_record.status |= TRACE_STALL;
+                end_trace_cycle(ctx, trace_record);
+            }
+            cycle++;
+            continue;
+        }
+        
+        // Fetch through the I-cache: a miss holds IF, sending bubbles
+        // into EX, until the line arrives
+        if (use_icache && !ctx.halt_flag && !ctx.flush_flag)
+        {
+            if (ctx.icache_stall_remaining == 0 && !ctx.icache_filled)
+            {
+                bool hit;
+                int stall_cycles = icache_fetch<Trace>(ctx, ctx.PC, hit);
+                if (ctx.perfetto && !hit) {
+                    perfetto_icache_miss(*ctx.perfetto, ctx.cycle_count, ctx.PC, stall_cycles);
+                }
+                ctx.icache_stall_remaining = stall_cycles;
+                ctx.icache_filled = (stall_cycles > 0);
+            }
+            
+            if (ctx.icache_stall_remaining > 0)
+            {
+                if (Trace::enabled) {
+                    *ctx.out << "  [ICACHE] Fetch stalled: " << ctx.icache_stall_remaining
+                         << " cycles remaining" << endl;
+                }
+                ctx.icache_stall_remaining--;
+                ctx.ifex_reg.valid = false;
+                ctx.ifex_reg.mnemonic = "BUBBLE";
+                if (tracing) {
+                    end_trace_cycle(ctx, trace_record);
+                }
+                cycle++;
+                continue;
+            }
+            ctx.icache_filled = false;
+        }
+        
+        // Update pipeline register
+        bool fetched = false;
+        if (!ctx.halt_flag)
+        {
+            fetched = !ctx.flush_flag && !ctx.stall_flag;
+            if (tracing) {
+                if (ctx.flush_flag) {
+                    trace_record.status |= TRACE_FLUSH;
+                } else if (!ctx.stall_flag) {
+                    trace_fetch(trace_record, ctx.PC, decode_instruction(ctx, ctx.PC).opcode);
+                }
+            }
+            update_pipeline_register(ctx);
+        }
+        
+        // Instruction Fetch: continue where the branch predictor says
+        // (a flush has already pointed PC at the right path)
+        if (fetched)
+        {
+            ctx.PC = ctx.ifex_reg.prediction.next_pc;
+        }
+        
+        ctx.stall_flag = false;
+        ctx.flush_flag = false;
+        
+        if (tracing) {
+            end_trace_cycle(ctx, trace_record);
+        }
+        
+        cycle++;
+    }
+}
+
+// How an instruction leaving ID gets one source register (deeper pipelines)
+enum OperandPath
+{
+    PATH_REGISTER_FILE,     // No producer in flight
+    PATH_EX_EX,
+    PATH_MEM_EX,
+    PATH_WB_ID,
+    PATH_STALL              // Not available yet: hold in ID
+};
+
+// Registers the instruction reads: R and R+1 for ALU ops, R for ST and branches
+static int source_registers(const StageLatch &latch, uint8_t sources[2])
+{
+    switch (latch.opcode)
+    {
+        case 0x01: // ADD, SUB, MUL, DIV
+        case 0x02:
+        case 0x03:
+        case 0x04:
+            sources[0] = latch.operand;
+            sources[1] = (latch.operand + 1) % 16;
+            return 2;
+        case 0x0E: // ST, BEQZ, BNEZ
+        case 0x05:
+        case 0x06:
+            sources[0] = latch.operand;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Path for register src of an ID instruction; only the youngest older
+// producer of src matters (later slots of a group are younger)
+static OperandPath operand_path(const SimulatorContext &ctx, uint8_t src, bool use_forwarding)
+{
+    const PipelineLayout &layout = ctx.pipeline_layout;
+    for (int s = layout.decode + 1; s < layout.depth; s++)
+    for (int w = ctx.issue_width - 1; w >= 0; w--)
+    {
+        const StageLatch &producer = ctx.stage[s][w];
+        if (!producer.valid || !(producer.flags & DECODE_WRITES_REG) || producer.operand != src)
+            continue;
+        if (s == layout.writeback)
+            return PATH_WB_ID;
+        if (!use_forwarding)
+            return PATH_STALL;
+        int ready = (producer.flags & DECODE_LOAD) ? layout.load_result : layout.execute;
+        if (s < ready)
+            return PATH_STALL;
+        return s == layout.execute ? PATH_EX_EX : PATH_MEM_EX;
+    }
+    return PATH_REGISTER_FILE;
+}
+
+// EX of an ALU op: R = R op R+1 (DIV by zero leaves R unchanged)
+static void execute_alu(SimulatorContext &ctx, uint8_t opcode, uint8_t reg)
+{
+    uint8_t val1 = read_register(ctx, reg);
+    uint8_t val2 = read_register(ctx, (reg + 1) % 16);
+    switch (opcode)
+    {
+        case 0x01: write_register(ctx, reg, val1 + val2); break;
+        case 0x02: write_register(ctx, reg, val1 - val2); break;
+        case 0x03: write_register(ctx, reg, val1 * val2); break;
+        case 0x04:
+            if (val2 != 0)
+                write_register(ctx, reg, val1 / val2);
+            break;
+        default:
+            break;
+    }
+}
+
+// LD/ST access of the memory stage; returns the cycles the pipeline
+// freezes for it
+template <class Trace>
+static int memory_access(SimulatorContext &ctx, StageLatch &latch, bool use_cache)
+{
+    latch.accessed = true;
+    if (!(latch.flags & (DECODE_LOAD | DECODE_STORE)))
+        return 0;
+    
+    bool store = (latch.flags & DECODE_STORE) != 0;
+    ctx.MAR = latch.address_data;
+    if (store)
+        ctx.MDR = read_register(ctx, latch.operand);
+    if (ctx.mem_trace) {
+        memory_trace_access(*ctx.mem_trace, ctx.instruction_count, latch.pc, ctx.MAR, store);
+    }
+    if (!use_cache)
+    {
+        // Direct memory access (no cache)
+        if (store)
+            write_data_memory(ctx, ctx.MAR, ctx.MDR);
+        else
+            write_register(ctx, latch.operand, read_data_memory(ctx, ctx.MAR));
+        return 0;
+    }
+    
+    bool hit;
+    int stall_cycles;
+    if (store)
+    {
+        uint64_t hits_before = ctx.cache_hits;
+        stall_cycles = cache_write<Trace>(ctx, ctx.MAR, ctx.MDR);
+        hit = ctx.cache_hits != hits_before;
+    }
+    else
+    {
+        int pending_cycles;
+        ctx.MDR = cache_read<Trace>(ctx, latch.pc, ctx.MAR, hit, stall_cycles, pending_cycles);
+        write_register(ctx, latch.operand, ctx.MDR);
+        ctx.reg_ready[latch.operand] = ctx.cycle_count + pending_cycles + 1;
+    }
+    if (ctx.perfetto) {
+        perfetto_cache_access(*ctx.perfetto, ctx.cycle_count, latch.pc, ctx.MAR, store, hit, stall_cycles);
+    }
+    return stall_cycles;
+}
+
+// Empty a stage slot
+static void clear_stage(StageLatch &latch)
+{
+    latch.valid = false;
+    latch.mnemonic = "BUBBLE";
+}
+
+// Issue port an instruction needs (superscalar ID)
+enum IssuePort
+{
+    PORT_ALU,
+    PORT_MEMORY,
+    PORT_BRANCH,
+    ISSUE_PORT_KINDS
+};
+
+static const int issue_port_limit[ISSUE_PORT_KINDS] = { ISSUE_ALU_PORTS, ISSUE_MEMORY_PORTS, ISSUE_BRANCH_PORTS };
+
+static IssuePort issue_port(const StageLatch &latch)
+{
+    if (latch.flags & (DECODE_LOAD | DECODE_STORE))
+        return PORT_MEMORY;
+    if (latch.flags & (DECODE_JUMP | DECODE_BRANCH | DECODE_HALT))
+        return PORT_BRANCH;
+    return PORT_ALU;
+}
+
+// True if later must not issue in the same group as earlier. Besides
+// reading earlier's result, it may not write a register earlier reads
+// or writes: LD/ST touch their register a stage after EX, where later
+// has already written it.
+static bool group_dependent(const StageLatch &earlier, const StageLatch &later)
+{
+    uint8_t sources[2];
+    int count = source_registers(later, sources);
+    if (earlier.flags & DECODE_WRITES_REG)
+        for (int i = 0; i < count; i++)
+            if (sources[i] == earlier.operand)
+                return true;
+    
+    if (!(later.flags & DECODE_WRITES_REG))
+        return false;
+    if ((earlier.flags & DECODE_WRITES_REG) && earlier.operand == later.operand)
+        return true;
+    count = source_registers(earlier, sources);
+    for (int i = 0; i < count; i++)
+        if (sources[i] == later.operand)
+            return true;
+    return false;
+}
+
+// N-stage in-order pipeline (pipeline_depth > 2, see pipeline.h). Each
+// cycle the stages do their work oldest first, ID issues as much of its
+// group as operands and ports allow, then every group moves one stage
+// on; the front end holds until ID has issued everything. A cache miss
+// freezes the whole pipeline as in the IF/EX model. Each stage holds
+// issue_width slots, oldest first.
+template <class Trace>
+static void run_stage_pipeline(SimulatorContext &ctx, bool use_forwarding, bool use_cache)
+{
+    const PipelineLayout &layout = ctx.pipeline_layout;
+    const int last = layout.depth - 1;
+    const int width = ctx.issue_width;
+    uint64_t cycle = 1;
+    bool tracing = (ctx.trace != nullptr || ctx.perfetto != nullptr);
+    bool use_icache = use_cache && ctx.icache_config.lines > 0;
+    bool nonblocking = use_cache && ctx.cache_config.mshrs > 0;
+    bool fetching = true;       // Cleared once HALT executes
+    
+    while (!ctx.halt_flag && cycle <= ctx.max_cycles &&
+           (ctx.detail_instructions == 0 || ctx.instruction_count < ctx.detail_instructions))
+    {
+        if (Trace::enabled) {
+            *ctx.out << "--- CYCLE " << setw(3) << cycle << " ---" << endl;
+            *ctx.out << " ";
+            for (int s = 0; s <= last; s++)
+            {
+                *ctx.out << (s ? " |" : "") << " " << pipeline_stage_name(layout, s) << ": " << ctx.stage[s][0].mnemonic;
+                for (int w = 1; w < width; w++)
+                    if (ctx.stage[s][w].valid)
+                        *ctx.out << "+" << ctx.stage[s][w].mnemonic;
+            }
+            *ctx.out << endl;
+        }
+        
+        increment_cycle(ctx);
+        
+        // Trace record for this cycle (EX as it enters the cycle)
+        PipelineTraceRecord trace_record = { 0, 0, 0, 0 };
+        if (tracing) {
+            trace_begin_cycle(ctx.stage[layout.execute][0], trace_record);
+        }
+        
+        if (use_cache && ctx.cache_stall_remaining > 0)
+        {
+            if (Trace::enabled) {
+                *ctx.out << "  [CACHE] Stalling: " << ctx.cache_stall_remaining << " cycles remaining" << endl;
+            }
+            ctx.cache_stall_remaining--;
+            if (tracing) {
+                trace_record.status |= TRACE_CACHE_STALL;
+                end_trace_cycle(ctx, trace_record);
+            }
+            cycle++;
+            continue;
+        }
+        
+        // Stage work, oldest first. Results go to the register file as
+        // they are produced; ID's hazard check decides only the timing.
+        int stall_cycles = 0;
+        for (int s = last; s >= layout.execute && stall_cycles == 0; s--)
+        for (int w = 0; w < width && stall_cycles == 0; w++)
+        {
+            StageLatch &latch = ctx.stage[s][w];
+            if (!latch.valid)
+                continue;
+            
+            if (s == layout.execute && !latch.executed)
+            {
+                if (Trace::enabled) {
+                    *ctx.out << "  [EX] Executing: " << latch.mnemonic << endl;
+                }
+                latch.executed = true;
+                if ((latch.flags & DECODE_WRITES_REG) && !(latch.flags & DECODE_LOAD))
+                    execute_alu(ctx, latch.opcode, latch.operand);
+                
+                // HALT squashes everything fetched after it; a
+                // mispredicted branch flushes the same stages
+                if (latch.flags & DECODE_HALT)
+                {
+                    for (int i = 0; i < layout.execute; i++)
+                        for (int j = 0; j < width; j++)
+                            clear_stage(ctx.stage[i][j]);
+                    ctx.icache_stall_remaining = 0;
+                    ctx.icache_filled = false;
+                    fetching = false;
+                }
+                else
+                {
+                    resolve_control_flow<Trace>(ctx, latch.pc, latch.opcode, latch.operand,
+                                                latch.address_data, latch.prediction);
+                }
+            }
+            
+            if (s == layout.memory && !latch.accessed)
+            {
+                stall_cycles = memory_access<Trace>(ctx, latch, use_cache);
+            }
+        }
+        
+        if (tracing && ctx.flush_flag) {
+            trace_record.status |= TRACE_FLUSH;
+        }
+        
+        if (stall_cycles > 0)
+        {
+            ctx.cache_stall_remaining = stall_cycles;
+            if (tracing) {
+                trace_record.status |= TRACE_CACHE_STALL;
+                end_trace_cycle(ctx, trace_record);
+            }
+            cycle++;
+            continue;
+        }
+        
+        // ID: issue in order while every source can reach EX in time,
+        // the group's own results are not needed and a port is free.
+        // Control flow ends the group.
+        StageLatch *group = ctx.stage[layout.decode];
+        int issued = 0;
+        int ports[ISSUE_PORT_KINDS] = { 0, 0, 0 };
+        bool blocked = false;
+        while (issued < width && group[issued].valid && !blocked)
+        {
+            const StageLatch &decoded = group[issued];
+            IssuePort port = issue_port(decoded);
+            if (ports[port] == issue_port_limit[port])
+            {
+                if (Trace::enabled) {
+                    *ctx.out << "  [ISSUE] " << decoded.mnemonic << " waits for a port" << endl;
+                }
+                ctx.issue_port_splits++;
+                break;
+            }
+            bool dependent = false;
+            for (int i = 0; i < issued && !dependent; i++)
+                dependent = group_dependent(group[i], decoded);
+            if (dependent)
+            {
+                if (Trace::enabled) {
+                    *ctx.out << "  [ISSUE] " << decoded.mnemonic << " depends on its group" << endl;
+                }
+                ctx.issue_dependency_splits++;
+                break;
+            }
+            
+            uint8_t sources[2];
+            OperandPath paths[2];
+            int count = source_registers(decoded, sources);
+            for (int i = 0; i < count; i++)
+            {
+                paths[i] = operand_path(ctx, sources[i], use_forwarding);
+                if (paths[i] == PATH_STALL)
+                    blocked = true;
+            }
+            
+            if (blocked)
+            {
+                if (Trace::enabled) {
+                    *ctx.out << "  [HAZARD] " << decoded.mnemonic << " waits in ID - STALL" << endl;
+                }
+                // Only an empty issue cycle is a stall
+                if (issued == 0)
+                    increment_stall(ctx);
+                else
+                    ctx.issue_dependency_splits++;
+                if (tracing) {
+                    trace_record.status |= TRACE_STALL;
+                }
+                break;
+            }
+            if (nonblocking)
+            {
+                // A register still being loaded holds ID too
+                for (int i = 0; i < count; i++)
+                    if (ctx.reg_ready[sources[i]] > ctx.cycle_count + 1)
+                        blocked = true;
+                if (blocked)
+                {
+                    if (Trace::enabled) {
+                        *ctx.out << "  [MSHR] " << decoded.mnemonic << " waiting on an outstanding load" << endl;
+                    }
+                    if (issued == 0)
+                    {
+                        ctx.mshr_dependency_stalls++;
+                        ctx.cache_stall_cycles++;
+                    }
+                    else
+                    {
+                        ctx.issue_dependency_splits++;
+                    }
+                    if (tracing) {
+                        trace_record.status |= TRACE_CACHE_STALL;
+                    }
+                    break;
+                }
+            }
+            
+            for (int i = 0; i < count; i++)
+            {
+                if (paths[i] == PATH_EX_EX || paths[i] == PATH_MEM_EX)
+                {
+                    if (Trace::enabled) {
+                        *ctx.out << "  [FORWARDING] R" << (int)sources[i]
+                             << (paths[i] == PATH_EX_EX ? " EX->EX" : " MEM->EX") << endl;
+                    }
+                    increment_forwarding(ctx);
+                    if (paths[i] == PATH_EX_EX)
+                        ctx.forward_ex_ex++;
+                    else
+                        ctx.forward_mem_ex++;
+                    if (tracing) {
+                        trace_record.status |= TRACE_FORWARD;
+                    }
+                }
+                else if (paths[i] == PATH_WB_ID)
+                {
+                    ctx.forward_wb_id++;
+                }
+            }
+            
+            ports[port]++;
+            issued++;
+            if (port == PORT_BRANCH)
+                blocked = true;
+        }
+        bool drained = (issued == width || !group[issued].valid);
+        
+        // Retire the last stage
+        for (int w = 0; w < width; w++)
+        {
+            const StageLatch &done = ctx.stage[last][w];
+            if (!done.valid)
+                continue;
+            increment_instruction(ctx);
+            if (done.flags & DECODE_HALT)
+            {
+                ctx.halt_flag = true;
+                ctx.PC = done.pc + 1;
+                if (tracing) {
+                    trace_record.status |= TRACE_HALT;
+                }
+            }
+        }
+        
+        // Advance: the back end always moves and EX gets the issued part
+        // of ID. The rest of ID moves up to slot 0 and, until it has all
+        // issued, the stages before ID keep their instructions.
+        for (int s = last; s > layout.execute; s--)
+            for (int w = 0; w < width; w++)
+                ctx.stage[s][w] = ctx.stage[s - 1][w];
+        for (int w = 0; w < width; w++)
+        {
+            if (w < issued || drained)
+                ctx.stage[layout.execute][w] = group[w];
+            else
+                clear_stage(ctx.stage[layout.execute][w]);
+        }
+        if (drained)
+        {
+            for (int s = layout.decode; s > 0; s--)
+                for (int w = 0; w < width; w++)
+                    ctx.stage[s][w] = ctx.stage[s - 1][w];
+            for (int w = 0; w < width; w++)
+                clear_stage(ctx.stage[0][w]);
+        }
+        else
+        {
+            for (int w = 0; w < width; w++)
+            {
+                if (w + issued < width)
+                    ctx.stage[layout.decode][w] = group[w + issued];
+                else
+                    clear_stage(group[w]);
+            }
+        }
+        
+        // Fetch up to width sequential instructions through the I-cache:
+        // a miss sends bubbles down until the line arrives. A predicted
+        // taken branch ends the group.
+        for (int w = 0; w < width && drained && fetching && !ctx.flush_flag; w++)
+        {
+            if (use_icache)
+            {
+                if (ctx.icache_stall_remaining == 0 && !ctx.icache_filled)
+                {
+                    bool hit;
+                    int miss_cycles = icache_fetch<Trace>(ctx, ctx.PC, hit);
+                    if (ctx.perfetto && !hit) {
+                        perfetto_icache_miss(*ctx.perfetto, ctx.cycle_count, ctx.PC, miss_cycles);
+                    }
+                    ctx.icache_stall_remaining = miss_cycles;
+                    ctx.icache_filled = (miss_cycles > 0);
+                }
+                
+                if (ctx.icache_stall_remaining > 0)
+                {
+                    if (Trace::enabled) {
+                        *ctx.out << "  [ICACHE] Fetch stalled: " << ctx.icache_stall_remaining
+                             << " cycles remaining" << endl;
+                    }
+                    ctx.icache_stall_remaining--;
+                    break;
+                }
+                ctx.icache_filled = false;
+            }
+            
+            const DecodedInstruction &inst = decode_instruction(ctx, ctx.PC);
+            StageLatch &fetched = ctx.stage[0][w];
+            fetched.valid = true;
+            fetched.pc = ctx.PC;
+            fetched.opcode = inst.opcode;
+            fetched.operand = inst.operand;
+            fetched.address_data = inst.address_data;
+            fetched.flags = inst.flags;
+            fetched.mnemonic = ctx.memory_text[ctx.PC].mnemonic.c_str();
+            fetched.executed = false;
+            fetched.accessed = false;
+            fetched.prediction = branch_predict(ctx.branch_state, ctx.branch_predictor, ctx.PC);
+            // Records hold one IF slot; wider runs are not traced (simulator.cpp)
+            if (tracing && w == 0) {
+                trace_fetch(trace_record, ctx.PC, inst.opcode);
+            }
+            ctx.PC = fetched.prediction.next_pc;
+            if (fetched.prediction.taken)
+                break;
+        }
+        ctx.flush_flag = false;
+        
+        if (tracing) {
+            end_trace_cycle(ctx, trace_record);
+        }
+        
+        cycle++;
+    }
+}
+
+// Cycle-level pipeline model. Every trace statement is guarded by the
+// compile-time Trace::enabled, so QuietTrace compiles them out.
+template <class Trace>
+static SimulationResult simulate_pipeline(SimulatorContext &ctx, bool use_forwarding, bool use_cache)
+{
+    SimulationResult result;
+    
+    // Set config name
+    if (!use_forwarding && !use_cache) {
+        result.config_name = "No optimization";
+    } else if (use_forwarding && !use_cache) {
+        result.config_name = "With Forwarding only";
+    } else {
+        result.config_name = "With Fwd + Cache";
+    }
+    
+    if (Trace::enabled) {
+        *ctx.out << "\n========================================" << endl;
+        *ctx.out << "  Running: " << result.config_name << endl;
+        *ctx.out << "========================================" << endl;
+    }
+    
+    // Initialize all components
+    initialize_data_memory(ctx);
+    initialize_registers(ctx);
+    initialize_memory(ctx);
+    predecode_program(ctx);
+    initialize_pipeline(ctx);
+    initialize_performance(ctx);
+    initialize_cache(ctx);
+    
+    // Configure forwarding unit
+    ctx.forwarding_unit.forward_enabled = use_forwarding;
+    
+    if (Trace::enabled) {
+        *ctx.out << "  Forwarding: " << (use_forwarding ? "ENABLED" : "DISABLED") << endl;
+        *ctx.out << "  Cache: " << (use_cache ? "ENABLED" : "DISABLED (direct memory)") << endl;
+        *ctx.out << endl;
+    }
+    
+    // Skip to the region of interest at functional speed; the pipeline
+    // starts empty at the resulting PC and the counters and cache only
+    // cover the detailed region
+    result.fast_forwarded = 0;
+    if (fast_forward_enabled(ctx.fast_forward))
+    {
+        result.fast_forwarded = fast_forward(ctx, ctx.fast_forward);
+        if (Trace::enabled) {
+            *ctx.out << "  Fast-forwarded " << result.fast_forwarded
+                 << " instructions (functional), detailed from PC=0x" << hex
+                 << setw(2) << setfill('0') << (int)ctx.PC << dec << setfill(' ') << endl;
+            *ctx.out << endl;
+        }
+    }
+    
+    if (ctx.pipeline_depth > 2)
+        run_stage_pipeline<Trace>(ctx, use_forwarding, use_cache);
+    else
+        run_ifex_pipeline<Trace>(ctx, use_forwarding, use_cache);
+    
+    // Store results
+    result.cycles = ctx.cycle_count;
+    result.instructions = ctx.instruction_count;
+    result.cpi = calculate_cpi(ctx);
+    result.ipc = calculate_ipc(ctx);
+    result.issue_width = ctx.issue_width;
+    result.stalls = ctx.stall_count + ctx.cache_stall_cycles + ctx.icache_stall_cycles;
+    result.forwardings = ctx.forwarding_count;
+    result.flushes = ctx.flush_count;
+    result.branches = ctx.branch_count;
+    result.branch_mispredicts = ctx.branch_mispredicts;
+    result.cache_hits = ctx.cache_hits;
+    result.cache_misses = ctx.cache_misses;
+    result.cache_writebacks = ctx.cache_writebacks;
+    result.memory_writes = ctx.memory_writes;
+    result.write_buffer_stalls = ctx.write_buffer_stalls;
+    result.icache_hits = ctx.icache_hits;
+    result.icache_misses = ctx.icache_misses;
+    result.mshr_dependency_stalls = ctx.mshr_dependency_stalls;
+    result.prefetch_issued = ctx.prefetch_issued;
+    result.prefetch_useful = ctx.prefetch_useful;
+    result.prefetch_late = ctx.prefetch_late;
+    result.compulsory_misses = ctx.compulsory_misses;
+    result.capacity_misses = ctx.capacity_misses;
+    result.conflict_misses = ctx.conflict_misses;
+    result.victim_hits = ctx.victim_hits;
+    result.hit_cycle_cap = !ctx.halt_flag && ctx.cycle_count >= ctx.max_cycles &&
+                           (ctx.detail_instructions == 0 || ctx.instruction_count < ctx.detail_instructions);
+    result.mlp = ctx.mshr_busy_cycles > 0 ? (double)ctx.miss_latency_cycles / ctx.mshr_busy_cycles : 0.0;
+    
+    // Dirty write-back lines hold the newest data; make memory current
+    if (use_cache) {
+        sync_cache_to_memory(ctx);
+    }
+    
+    if (Trace::enabled) {
+        print_results(ctx);
+    }
+    
+    return result;
+}
+
+// Run a single simulation with current configuration
+SimulationResult run_simulation(SimulatorContext &ctx, bool use_forwarding, bool use_cache, bool verbose)
+{
+    if (verbose)
+        return simulate_pipeline<VerboseTrace>(ctx, use_forwarding, use_cache);
+    return simulate_pipeline<QuietTrace>(ctx, use_forwarding, use_cache);
+}
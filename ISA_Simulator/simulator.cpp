@@ -3,339 +3,53 @@
 #include <fstream>
 #include <sstream>
 #include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <cstdlib>
+#include <climits>
+#include <chrono>
+#include "simulator.h"
+#include "simulator_context.h"
+#include "instruction_memory.h"
 #include "data_memory.h"
 #include "registers.h"
 #include "pipeline.h"
 #include "performance.h"
 #include "log_handler.h"
 #include "cache.h"
+#include "thread_pool.h"
+#include "sweep.h"
+#include "program_loader.h"
+#include "functional.h"
+#include "sampling.h"
+#include "pipeline_trace.h"
+#include "perfetto_trace.h"
+#include "memory_trace.h"
 
 using namespace std;
 
-// Decoded instruction structure (from pipeline.cpp)
-struct DecodedInstruction
-{
-    uint8_t opcode;
-    uint8_t operand;
-    uint8_t address_data;
-    string mnemonic;
-};
-
-// Forward declarations for memory functions
-void initialize_memory();
-void display_program_section();
-DecodedInstruction decode_instruction(uint8_t pc_value);
-
-// External pipeline functions
-extern void update_pipeline_register();
-
 // Configuration modes
 enum SimMode {
     MODE_NO_OPTIMIZATION = 1,    // Stall-only (Assignment III baseline)
     MODE_FORWARDING_ONLY = 2,    // Forwarding enabled, No cache
     MODE_FORWARDING_CACHE = 3,   // Forwarding + Cache (Full Assignment IV)
-    MODE_COMPARISON = 4          // Run all three and compare
+    MODE_COMPARISON = 4,         // Run all three and compare
+    MODE_SWEEP = 5,              // Design-space sweep over cache/forwarding
+    MODE_SAMPLED = 6             // SimPoint-style sampled simulation
 };
 
-// Structure to store results for comparison
-struct SimulationResult {
-    string config_name;
-    uint64_t cycles;
-    uint64_t instructions;
-    double cpi;
-    uint64_t stalls;
-    uint64_t forwardings;
-    uint64_t cache_hits;
-    uint64_t cache_misses;
+// Configurations run by MODE_COMPARISON, in table order
+struct ComparisonConfig {
+    const char *banner;
+    bool use_forwarding;
+    bool use_cache;
 };
 
-// Global configuration
-bool forwarding_enabled_global = true;
-bool cache_enabled_global = true;
-
-// Print results in exact format required by assignment
-void print_results()
-{
-    printf("\nProgram finished.\n");
-    printf("Cycles = %llu\n", (unsigned long long)cycle_count);
-    printf("Instructions = %llu\n", (unsigned long long)instruction_count);
-    printf("CPI = %.2f\n", calculate_cpi());
-    printf("Stalls = %llu\n", (unsigned long long)(stall_count + cache_stall_cycles));
-    printf("Forwardings = %llu\n", (unsigned long long)forwarding_count);
-    printf("Cache hits = %llu\n", (unsigned long long)cache_hits);
-    printf("Cache misses = %llu\n", (unsigned long long)cache_misses);
-}
-
-// Run a single simulation with current configuration
-SimulationResult run_simulation(bool use_forwarding, bool use_cache, bool verbose)
-{
-    SimulationResult result;
-    
-    // Set configuration
-    forwarding_enabled_global = use_forwarding;
-    cache_enabled_global = use_cache;
-    
-    // Set config name
-    if (!use_forwarding && !use_cache) {
-        result.config_name = "No optimization";
-    } else if (use_forwarding && !use_cache) {
-        result.config_name = "With Forwarding only";
-    } else {
-        result.config_name = "With Fwd + Cache";
-    }
-    
-    if (verbose) {
-        cout << "\n========================================" << endl;
-        cout << "  Running: " << result.config_name << endl;
-        cout << "========================================" << endl;
-    }
-    
-    // Initialize all components
-    initialize_data_memory();
-    initialize_registers();
-    initialize_memory();
-    initialize_pipeline();
-    initialize_performance();
-    initialize_cache();
-    
-    // Configure forwarding unit
-    forwarding_unit.forward_enabled = use_forwarding;
-    
-    if (verbose) {
-        cout << "  Forwarding: " << (use_forwarding ? "ENABLED" : "DISABLED") << endl;
-        cout << "  Cache: " << (use_cache ? "ENABLED" : "DISABLED (direct memory)") << endl;
-        cout << endl;
-    }
-    
-    // Main simulation loop
-    int max_cycles = 100;
-    int cycle = 1;
-    
-    while (!halt_flag && cycle <= max_cycles)
-    {
-        if (verbose) {
-            cout << "--- CYCLE " << setw(3) << cycle << " ---" << endl;
-        }
-        
-        // Increment cycle counter
-        increment_cycle();
-        
-        // Check for cache stall remaining (only if cache enabled)
-        if (use_cache && cache_stall_remaining > 0)
-        {
-            if (verbose) {
-                cout << "  [CACHE] Stalling: " << cache_stall_remaining << " cycles remaining" << endl;
-            }
-            cache_stall_remaining--;
-            cycle++;
-            continue;
-        }
-        
-        // Execute current EX stage instruction
-        if (ifex_reg.valid)
-        {
-            if (verbose) {
-                cout << "  [EX] Executing: " << ifex_reg.mnemonic << endl;
-            }
-            
-            uint8_t opcode = ifex_reg.opcode;
-            uint8_t reg = ifex_reg.operand;
-            uint8_t data = ifex_reg.address_data;
-            
-            // Reset result fields
-            ifex_reg.produces_result = false;
-            ifex_reg.result_ready = false;
-            
-            switch (opcode)
-            {
-                case 0x01: // ADD
-                {
-                    uint8_t val1 = read_register(reg);
-                    uint8_t val2 = read_register((reg + 1) % 16);
-                    uint8_t res = val1 + val2;
-                    write_register(reg, res);
-                    ifex_reg.produces_result = true;
-                    ifex_reg.result_value = res;
-                    ifex_reg.result_ready = true;
-                    ifex_reg.dest_reg = reg;
-                    increment_instruction();
-                    break;
-                }
-                case 0x02: // SUB
-                {
-                    uint8_t val1 = read_register(reg);
-                    uint8_t val2 = read_register((reg + 1) % 16);
-                    uint8_t res = val1 - val2;
-                    write_register(reg, res);
-                    ifex_reg.produces_result = true;
-                    ifex_reg.result_value = res;
-                    ifex_reg.result_ready = true;
-                    ifex_reg.dest_reg = reg;
-                    increment_instruction();
-                    break;
-                }
-                case 0x03: // MUL
-                {
-                    uint8_t val1 = read_register(reg);
-                    uint8_t val2 = read_register((reg + 1) % 16);
-                    uint8_t res = val1 * val2;
-                    write_register(reg, res);
-                    ifex_reg.produces_result = true;
-                    ifex_reg.result_value = res;
-                    ifex_reg.result_ready = true;
-                    ifex_reg.dest_reg = reg;
-                    increment_instruction();
-                    break;
-                }
-                case 0x04: // DIV
-                {
-                    uint8_t val1 = read_register(reg);
-                    uint8_t val2 = read_register((reg + 1) % 16);
-                    if (val2 != 0) {
-                        uint8_t res = val1 / val2;
-                        write_register(reg, res);
-                        ifex_reg.produces_result = true;
-                        ifex_reg.result_value = res;
-                        ifex_reg.result_ready = true;
-                        ifex_reg.dest_reg = reg;
-                    }
-                    increment_instruction();
-                    break;
-                }
-                case 0x0D: // LD
-                {
-                    MAR = data;
-                    if (use_cache) {
-                        bool hit;
-                        int stall_cycles;
-                        MDR = cache_read(MAR, hit, stall_cycles);
-                        if (!hit && stall_cycles > 0) {
-                            cache_stall_remaining = stall_cycles;
-                        }
-                    } else {
-                        // Direct memory access (no cache)
-                        MDR = read_data_memory(MAR);
-                    }
-                    write_register(reg, MDR);
-                    ifex_reg.produces_result = true;
-                    ifex_reg.result_value = MDR;
-                    ifex_reg.result_ready = true;
-                    ifex_reg.dest_reg = reg;
-                    increment_instruction();
-                    break;
-                }
-                case 0x0E: // ST
-                {
-                    MAR = data;
-                    MDR = read_register(reg);
-                    if (use_cache) {
-                        int stall_cycles = cache_write(MAR, MDR);
-                        if (stall_cycles > 0) {
-                            cache_stall_remaining = stall_cycles;
-                        }
-                    } else {
-                        write_data_memory(MAR, MDR);
-                    }
-                    increment_instruction();
-                    break;
-                }
-                case 0x08: // JMP
-                case 0x0A: // JMP (alternate opcode)
-                {
-                    PC = data;
-                    flush_flag = true;
-                    increment_instruction();
-                    break;
-                }
-                case 0x0F: // HALT
-                case 0x10:
-                {
-                    halt_flag = true;
-                    increment_instruction();
-                    break;
-                }
-                default:
-                    increment_instruction();
-                    break;
-            }
-        }
-        
-        // Check if cache caused a stall
-        if (use_cache && cache_stall_remaining > 0)
-        {
-            cycle++;
-            continue;
-        }
-        
-        // Check for hazards (detect_hazard_or_forward from professor's code)
-        bool need_stall = false;
-        if (ifex_reg.valid && ifex_reg.is_load && PC < 256)
-        {
-            DecodedInstruction if_inst = decode_instruction(PC);
-            if (if_inst.operand == ifex_reg.dest_reg)
-            {
-                if (use_forwarding && ifex_reg.result_ready)
-                {
-                    // Forwarding available - no stall
-                    if (verbose) {
-                        cout << "  [FORWARDING] R" << (int)ifex_reg.dest_reg 
-                             << " forwarded (hazard avoided)" << endl;
-                    }
-                    increment_forwarding();
-                }
-                else
-                {
-                    // No forwarding - must stall
-                    if (verbose) {
-                        cout << "  [HAZARD] Load-Use detected - STALL" << endl;
-                    }
-                    need_stall = true;
-                    increment_stall();
-                }
-            }
-        }
-        
-        if (need_stall)
-        {
-            ifex_reg.valid = false;
-            ifex_reg.mnemonic = "BUBBLE";
-            cycle++;
-            continue;
-        }
-        
-        // Update pipeline register
-        if (!halt_flag)
-        {
-            update_pipeline_register();
-        }
-        
-        // Instruction Fetch (fetch_stage from professor's code)
-        if (!halt_flag && !stall_flag)
-        {
-            PC++;
-        }
-        
-        stall_flag = false;
-        flush_flag = false;
-        
-        cycle++;
-    }
-    
-    // Store results
-    result.cycles = cycle_count;
-    result.instructions = instruction_count;
-    result.cpi = calculate_cpi();
-    result.stalls = stall_count + cache_stall_cycles;
-    result.forwardings = forwarding_count;
-    result.cache_hits = cache_hits;
-    result.cache_misses = cache_misses;
-    
-    if (verbose) {
-        print_results();
-    }
-    
-    return result;
-}
+const ComparisonConfig comparison_configs[3] = {
+    { "\n[CONFIG 1] Running: No optimization (stall-only)...", false, false },
+    { "[CONFIG 2] Running: With Forwarding only...",           true,  false },
+    { "[CONFIG 3] Running: With Forwarding + Cache...",        true,  true  },
+};
 
 // Display comparison table
 void display_comparison_table(SimulationResult results[3])
@@ -381,6 +95,8 @@ void display_comparison_table(SimulationResult results[3])
         printf("  Cycles = %llu\n", (unsigned long long)results[i].cycles);
         printf("  Instructions = %llu\n", (unsigned long long)results[i].instructions);
         printf("  CPI = %.2f\n", results[i].cpi);
+        if (results[i].issue_width > 1)
+            printf("  IPC = %.2f\n", results[i].ipc);
         printf("  Stalls = %llu\n", (unsigned long long)results[i].stalls);
         printf("  Forwardings = %llu\n", (unsigned long long)results[i].forwardings);
         if (i == 2) {
@@ -431,44 +147,438 @@ int main(int argc, char* argv[])
     
     if (argc > 1) {
         int arg = atoi(argv[1]);
-        if (arg >= 1 && arg <= 4) {
+        if (arg >= 1 && arg <= 6) {
             mode = (SimMode)arg;
         }
     }
     
+    // Optional "-j [N]": run the comparison configurations concurrently
+    // on N worker threads (default: one per hardware thread)
+    bool parallel = false;
+    unsigned int jobs = 0;
+    
+    // Sweep options (mode 5): value lists "a,b,c" or ranges "a:b[:step]"
+    SweepSpec sweep_spec = default_sweep_spec();
+    SweepFormat sweep_format = SWEEP_CSV;
+    string sweep_file = "";
+    
+    // Program to run: program.hex style text (--program) or raw binary
+    // image (--image); default is the built-in test program
+    string program_path = "";
+    bool program_is_binary = false;
+    
+    // Functional fast-forward before detailed timing: stop after N
+    // instructions (--ff-insts) and/or at an address (--ff-pc)
+    FastForwardSpec fast_forward_spec = { 0, -1 };
+    
+    // Sampled simulation options (mode 6)
+    SamplingSpec sampling_spec = default_sampling_spec();
+    bool verify_sampling = false;
+    
+    // Binary per-cycle pipeline trace (modes 1-3)
+    string trace_path = "";
+    
+    // Chrome/Perfetto JSON timeline (modes 1-3)
+    string perfetto_path = "";
+    
+    // Data address stream for cache_replay (modes 1-3)
+    string mem_trace_path = "";
+    string heatmap_path = "";
+    
+    // Per-cycle output of single runs (modes 1-3); the cycle cap
+    // (modes 1-5) lives in sweep_spec
+    bool max_cycles_set = false;
+    bool quiet = false;
+    
+    for (int i = 2; i < argc; i++) {
+        string opt = argv[i];
+        bool has_value = (i + 1 < argc);
+        bool ok = true;
+        
+        if (opt == "-j") {
+            parallel = true;
+            if (has_value && isdigit((unsigned char)argv[i + 1][0])) {
+                jobs = atoi(argv[++i]);
+            }
+        } else if (opt == "--lines" && has_value) {
+            ok = parse_sweep_values(argv[++i], true, sweep_spec.lines);
+        } else if (opt == "--ways" && has_value) {
+            ok = parse_sweep_values(argv[++i], true, sweep_spec.ways);
+        } else if (opt == "--block" && has_value) {
+            ok = parse_sweep_values(argv[++i], true, sweep_spec.block_size);
+        } else if (opt == "--policy" && has_value) {
+            ok = parse_replacement_values(argv[++i], sweep_spec.replacement);
+        } else if (opt == "--write" && has_value) {
+            ok = parse_write_policy_values(argv[++i], sweep_spec.write_policy);
+        } else if (opt == "--wbuf" && has_value) {
+            ok = parse_sweep_values(argv[++i], false, sweep_spec.write_buffer);
+        } else if (opt == "--mshrs" && has_value) {
+            ok = parse_sweep_values(argv[++i], false, sweep_spec.mshrs);
+        } else if (opt == "--prefetch" && has_value) {
+            ok = parse_prefetch_values(argv[++i], sweep_spec.prefetcher);
+        } else if (opt == "--victim" && has_value) {
+            ok = parse_sweep_values(argv[++i], false, sweep_spec.victim_lines);
+        } else if (opt == "--swap" && has_value) {
+            ok = parse_sweep_values(argv[++i], false, sweep_spec.victim_swap_cycles);
+        } else if (opt == "--l2" && has_value) {
+            ok = parse_cache_level(argv[++i], sweep_spec.hierarchy.level[0]);
+            if (sweep_spec.hierarchy.lower_levels < 1) {
+                sweep_spec.hierarchy.lower_levels = 1;
+            }
+        } else if (opt == "--l3" && has_value && sweep_spec.hierarchy.lower_levels >= 1) {
+            ok = parse_cache_level(argv[++i], sweep_spec.hierarchy.level[1]);
+            sweep_spec.hierarchy.lower_levels = 2;
+        } else if (opt == "--icache" && has_value) {
+            sweep_spec.icache.lines = CACHE_LINES;
+            ok = parse_cache_spec(argv[++i], sweep_spec.icache);
+        } else if (opt == "--hit" && has_value) {
+            ok = parse_sweep_values(argv[++i], false, sweep_spec.hit_cycles);
+        } else if (opt == "--penalty" && has_value) {
+            ok = parse_sweep_values(argv[++i], false, sweep_spec.miss_penalty);
+        } else if (opt == "--depth" && has_value) {
+            ok = parse_sweep_values(argv[++i], false, sweep_spec.depth);
+        } else if (opt == "--width" && has_value) {
+            ok = parse_sweep_values(argv[++i], false, sweep_spec.width);
+        } else if (opt == "--bpred" && has_value) {
+            ok = parse_branch_predictor_values(argv[++i], sweep_spec.predictor);
+        } else if (opt == "--fwd" && has_value) {
+            ok = parse_sweep_values(argv[++i], false, sweep_spec.forwarding);
+        } else if (opt == "--format" && has_value) {
+            string fmt = argv[++i];
+            ok = (fmt == "csv" || fmt == "json");
+            sweep_format = (fmt == "json") ? SWEEP_JSON : SWEEP_CSV;
+        } else if (opt == "-o" && has_value) {
+            sweep_file = argv[++i];
+        } else if ((opt == "--program" || opt == "--image") && has_value) {
+            program_path = argv[++i];
+            program_is_binary = (opt == "--image");
+        } else if (opt == "--ff-insts" && has_value) {
+            char *end = nullptr;
+            fast_forward_spec.instructions = strtoull(argv[++i], &end, 0);
+            ok = (*end == '\0');
+        } else if (opt == "--ff-pc" && has_value) {
+            char *end = nullptr;
+            fast_forward_spec.stop_pc = (int)strtol(argv[++i], &end, 0);
+            ok = (*end == '\0' && fast_forward_spec.stop_pc >= 0 && fast_forward_spec.stop_pc < 256);
+        } else if (opt == "--interval" && has_value) {
+            char *end = nullptr;
+            sampling_spec.interval = strtoull(argv[++i], &end, 0);
+            ok = (*end == '\0' && sampling_spec.interval > 0);
+        } else if (opt == "--clusters" && has_value) {
+            char *end = nullptr;
+            long clusters = strtol(argv[++i], &end, 0);
+            sampling_spec.clusters = (int)clusters;
+            ok = (*end == '\0' && clusters > 0 && clusters <= INT_MAX);
+        } else if (opt == "--max-insts" && has_value) {
+            char *end = nullptr;
+            sampling_spec.max_instructions = strtoull(argv[++i], &end, 0);
+            ok = (*end == '\0' && sampling_spec.max_instructions > 0);
+        } else if (opt == "--verify") {
+            verify_sampling = true;
+        } else if (opt == "--trace" && has_value) {
+            trace_path = argv[++i];
+        } else if (opt == "--perfetto" && has_value) {
+            perfetto_path = argv[++i];
+        } else if (opt == "--mem-trace" && has_value) {
+            mem_trace_path = argv[++i];
+        } else if (opt == "--set-heatmap" && has_value) {
+            heatmap_path = argv[++i];
+        } else if (opt == "--max-cycles" && has_value) {
+            char *end = nullptr;
+            sweep_spec.max_cycles = strtoull(argv[++i], &end, 0);
+            ok = (*end == '\0' && sweep_spec.max_cycles > 0);
+            max_cycles_set = true;
+        } else if (opt == "-q") {
+            quiet = true;
+        } else {
+            ok = false;
+        }
+        
+        if (!ok) {
+            cerr << "Invalid option or value: " << opt << endl;
+            return 1;
+        }
+    }
+    
+    // Sampled runs are bounded by instruction counts, not cycles
+    if (mode == MODE_SAMPLED && max_cycles_set) {
+        cerr << "--max-cycles applies to modes 1-5 only" << endl;
+        return 1;
+    }
+    
+    // Sampling places its own fast-forward before every simulation point
+    if (mode == MODE_SAMPLED && fast_forward_enabled(fast_forward_spec)) {
+        cerr << "--ff-insts and --ff-pc apply to modes 1-5 only" << endl;
+        return 1;
+    }
+    
+    // Trace files are written by single runs only; the heatmap needs the cache
+    bool single_run = (mode == MODE_NO_OPTIMIZATION || mode == MODE_FORWARDING_ONLY ||
+                       mode == MODE_FORWARDING_CACHE);
+    if (!single_run && (!trace_path.empty() || !perfetto_path.empty() || !mem_trace_path.empty())) {
+        cerr << "--trace, --perfetto and --mem-trace apply to modes 1-3 only" << endl;
+        return 1;
+    }
+    if (mode != MODE_FORWARDING_CACHE && !heatmap_path.empty()) {
+        cerr << "--set-heatmap applies to mode 3 only" << endl;
+        return 1;
+    }
+    
     cout << "Select mode:" << endl;
     cout << "  1 = No optimization (Stall-only, Assignment III baseline)" << endl;
     cout << "  2 = With Forwarding only" << endl;
     cout << "  3 = With Forwarding + Cache" << endl;
     cout << "  4 = Run ALL configurations and compare (default)" << endl;
+    cout << "      add -j [N] to run them concurrently on N threads" << endl;
+    cout << "  5 = Sweep cache/forwarding design space" << endl;
+    cout << "      --lines L --ways W --block B --policy lru|plru|random|srrip|brrip" << endl;
+    cout << "      --write wt|wb --wbuf N (write buffer entries, 0 = none)" << endl;
+    cout << "      --mshrs N (outstanding misses, 0 = blocking cache)" << endl;
+    cout << "      --prefetch none|next|stride|stream" << endl;
+    cout << "      --victim N --swap S (victim cache lines, 0 = none, and hit latency)" << endl;
+    cout << "      --depth 2..8 (pipeline stages, 2 = IF/EX)" << endl;
+    cout << "      --width 1..4 (in-order issue width, above 1 needs --depth 3 or more)" << endl;
+    cout << "      --bpred none|static|bimodal|gshare|tage (BTB + direction predictor)" << endl;
+    cout << "      --hit H --penalty P --fwd 0,1 [-j N] [--format csv|json] [-o file]" << endl;
+    cout << "      --l2 SPEC [--l3 SPEC] (lower levels, penalty = memory latency)" << endl;
+    cout << "      SPEC = lines=N,ways=N,block=N,hit=N,inclusion=nine|inclusive|exclusive,policy=P" << endl;
+    cout << "      --icache lines=N,ways=N,block=N,hit=N,penalty=N,policy=P (I-cache on fetch)" << endl;
+    cout << "  6 = Sampled simulation (SimPoint-style, Fwd + Cache)" << endl;
+    cout << "      --interval N --clusters K --max-insts N [--verify] [-j N]" << endl;
+    cout << "  any mode: --program file.hex | --image file.bin" << endl;
+    cout << "  modes 1-5: --ff-insts N | --ff-pc ADDR (fast-forward, then detailed)" << endl;
+    cout << "  modes 1-4, 6: cache, --depth/--width/--bpred, --l2/--l3 and --icache" << endl;
+    cout << "             options above, first value of each list" << endl;
+    cout << "  modes 1-3: --trace file.bin (binary pipeline trace, see trace_decode)" << endl;
+    cout << "             --perfetto file.json (timeline for ui.perfetto.dev)" << endl;
+    cout << "             (--trace and --perfetto need --width 1)" << endl;
+    cout << "             --mem-trace file.mem (LD/ST stream, see cache_replay)" << endl;
+    cout << "             --set-heatmap file.csv (per-set accesses/misses, mode 3)" << endl;
+    cout << "             -q (no per-cycle output)" << endl;
+    cout << "  modes 1-5: --max-cycles N (cycle cap per run, default 100)" << endl;
     cout << "\nRunning mode: " << mode << endl;
     
-    if (mode == MODE_COMPARISON)
+    // Cache organization for modes 1-4 and 6
+    CacheConfig cache_config = first_cache_config(sweep_spec);
+    if (mode != MODE_SWEEP && !is_valid_cache_config(cache_config)) {
+        cerr << "Invalid cache config: " << describe_cache_config(cache_config) << endl;
+        return 1;
+    }
+    if (mode != MODE_SWEEP && !is_valid_cache_hierarchy(cache_config, sweep_spec.hierarchy)) {
+        cerr << "Invalid cache hierarchy behind L1: " << describe_cache_config(cache_config) << endl;
+        return 1;
+    }
+    // Pipeline depth and issue width for modes 1-4 and 6
+    int pipeline_depth = sweep_spec.depth[0];
+    PipelineLayout layout;
+    if (mode != MODE_SWEEP && !configure_pipeline_layout(pipeline_depth, layout)) {
+        cerr << "Invalid pipeline depth: " << pipeline_depth << endl;
+        return 1;
+    }
+    int issue_width = sweep_spec.width[0];
+    if (mode != MODE_SWEEP && !is_valid_issue_width(issue_width, pipeline_depth)) {
+        cerr << "Invalid issue width " << issue_width << " for pipeline depth " << pipeline_depth << endl;
+        return 1;
+    }
+    // Trace records hold one IF/EX slot
+    if (issue_width > 1 && (!trace_path.empty() || !perfetto_path.empty())) {
+        cerr << "--trace and --perfetto need issue width 1" << endl;
+        return 1;
+    }
+    if (mode != MODE_SWEEP && sweep_spec.icache.lines > 0 && !is_valid_cache_config(sweep_spec.icache)) {
+        cerr << "Invalid I-cache config: " << describe_cache_config(sweep_spec.icache) << endl;
+        return 1;
+    }
+    
+    // Load the program once; every context copies it in initialize_memory()
+    ProgramImage *program = nullptr;
+    if (!program_path.empty()) {
+        program = new ProgramImage;
+        auto load_start = chrono::steady_clock::now();
+        bool loaded = program_is_binary ? load_binary_image(program_path, *program)
+                                        : load_hex_program(program_path, *program);
+        if (!loaded) {
+            delete program;
+            return 1;
+        }
+        auto load_time = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - load_start);
+        cout << "Loaded " << program->length << " words from " << program_path
+             << " in " << load_time.count() << " us" << endl;
+    }
+    
+    if (mode == MODE_SWEEP)
+    {
+        if (sweep_file.empty()) {
+            sweep_file = (sweep_format == SWEEP_JSON) ? "sweep.json" : "sweep.csv";
+        }
+        
+        // Validate before truncating the output file
+        size_t points;
+        if (!validate_sweep(sweep_spec) || !sweep_point_count(sweep_spec, points)) {
+            delete program;
+            return 1;
+        }
+        
+        ofstream sweep_out(sweep_file.c_str());
+        if (!sweep_out.is_open()) {
+            cerr << "Error: Could not open " << sweep_file << endl;
+            delete program;
+            return 1;
+        }
+        
+        cout << "\n*** SWEEPING " << points << " DESIGN POINTS ***" << endl;
+        
+        auto start = chrono::steady_clock::now();
+        if (!run_sweep(sweep_spec, program, fast_forward_spec, jobs, sweep_format, sweep_out)) {
+            delete program;
+            return 1;
+        }
+        auto elapsed = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+        
+        cout << "Wrote " << points << " rows to " << sweep_file
+             << " in " << elapsed.count() << " ms" << endl;
+    }
+    else if (mode == MODE_SAMPLED)
+    {
+        cout << "\n*** SAMPLED SIMULATION (Fwd + Cache) ***" << endl;
+        
+        // Every simulation point uses the same configuration as modes 1-4
+        sampling_spec.cache = cache_config;
+        sampling_spec.hierarchy = sweep_spec.hierarchy;
+        sampling_spec.icache = sweep_spec.icache;
+        sampling_spec.pipeline_depth = pipeline_depth;
+        sampling_spec.issue_width = issue_width;
+        sampling_spec.predictor = sweep_spec.predictor[0];
+        
+        SamplingResult sampled;
+        auto start = chrono::steady_clock::now();
+        if (!run_sampled_simulation(sampling_spec, program, true, true, jobs, sampled)) {
+            cerr << "Error: program executed no instructions" << endl;
+            delete program;
+            return 1;
+        }
+        auto sampled_time = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+        
+        printf("Profiled %llu instructions in %zu intervals of %llu\n",
+               (unsigned long long)sampled.total_instructions, sampled.intervals,
+               (unsigned long long)sampling_spec.interval);
+        printf("\nSimulation points:\n");
+        printf("  Interval |    Start | Weight |  CPI\n");
+        for (size_t i = 0; i < sampled.points.size(); i++) {
+            const SimulationPoint &p = sampled.points[i];
+            printf("  %8zu | %8llu | %5.1f%% | %.2f\n", p.interval_index,
+                   (unsigned long long)p.start, p.weight * 100, p.result.cpi);
+        }
+        
+        printf("\nEstimated (weighted):\n");
+        printf("Cycles = %.0f\n", sampled.cycles);
+        printf("Instructions = %llu\n", (unsigned long long)sampled.total_instructions);
+        printf("CPI = %.2f\n", sampled.cpi);
+        printf("Stalls = %.0f\n", sampled.stalls);
+        printf("Forwardings = %.0f\n", sampled.forwardings);
+        printf("Cache hits = %.0f\n", sampled.cache_hits);
+        printf("Cache misses = %.0f\n", sampled.cache_misses);
+        printf("Detailed instructions = %llu (%.1f%%) in %lld ms\n",
+               (unsigned long long)sampled.detailed_instructions,
+               100.0 * sampled.detailed_instructions / sampled.total_instructions,
+               (long long)sampled_time.count());
+        
+        if (verify_sampling)
+        {
+            // Full detailed run over the same instructions for comparison
+            ostream discard(nullptr);
+            SimulatorContext *ctx = new SimulatorContext;
+            ctx->out = &discard;
+            ctx->program = program;
+            ctx->cache_config = sampling_spec.cache;
+            ctx->hierarchy_config = sampling_spec.hierarchy;
+            ctx->icache_config = sampling_spec.icache;
+            ctx->pipeline_depth = sampling_spec.pipeline_depth;
+            ctx->issue_width = sampling_spec.issue_width;
+            ctx->branch_predictor = sampling_spec.predictor;
+            ctx->detail_instructions = sampled.total_instructions;
+            ctx->max_cycles = UINT64_MAX;
+            
+            start = chrono::steady_clock::now();
+            SimulationResult full = run_simulation(*ctx, true, true, false);
+            auto full_time = chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now() - start);
+            delete ctx;
+            
+            printf("\nFull detailed run:\n");
+            printf("Cycles = %llu\n", (unsigned long long)full.cycles);
+            printf("CPI = %.2f (sampled error %+.2f%%)\n", full.cpi,
+                   full.cpi > 0 ? (sampled.cpi - full.cpi) / full.cpi * 100 : 0.0);
+            printf("Cache misses = %llu\n", (unsigned long long)full.cache_misses);
+            printf("Time = %lld ms\n", (long long)full_time.count());
+        }
+    }
+    else if (mode == MODE_COMPARISON)
     {
         cout << "\n*** RUNNING ALL THREE CONFIGURATIONS ***\n" << endl;
         
+        // One independent context per configuration
+        SimulatorContext *contexts = new SimulatorContext[3];
+        for (int i = 0; i < 3; i++) {
+            contexts[i].program = program;
+            contexts[i].fast_forward = fast_forward_spec;
+            contexts[i].max_cycles = sweep_spec.max_cycles;
+            contexts[i].cache_config = cache_config;
+            contexts[i].hierarchy_config = sweep_spec.hierarchy;
+            contexts[i].icache_config = sweep_spec.icache;
+            contexts[i].pipeline_depth = pipeline_depth;
+            contexts[i].issue_width = issue_width;
+            contexts[i].branch_predictor = sweep_spec.predictor[0];
+        }
+        
         // Display program first
-        initialize_memory();
+        initialize_memory(contexts[0]);
         cout << "=== TEST PROGRAM ===" << endl;
-        display_program_section();
+        display_program_section(contexts[0]);
         
         // Array to store results
         SimulationResult results[3];
         
-        // Run configuration 1: No optimization
-        cout << "\n[CONFIG 1] Running: No optimization (stall-only)..." << endl;
-        results[0] = run_simulation(false, false, false);
-        
-        // Run configuration 2: Forwarding only
-        cout << "[CONFIG 2] Running: With Forwarding only..." << endl;
-        results[1] = run_simulation(true, false, false);
+        if (parallel)
+        {
+            // Each configuration runs on a worker with its output buffered,
+            // then the buffers are replayed in order so the report matches
+            // the serial run exactly
+            ostringstream run_output[3];
+            ThreadPool pool(jobs);
+            
+            for (int i = 0; i < 3; i++) {
+                contexts[i].out = &run_output[i];
+                pool.submit([&, i]() {
+                    results[i] = run_simulation(contexts[i], comparison_configs[i].use_forwarding,
+                                                comparison_configs[i].use_cache, false);
+                });
+            }
+            pool.wait_all();
+            
+            for (int i = 0; i < 3; i++) {
+                cout << comparison_configs[i].banner << endl;
+                cout << run_output[i].str();
+            }
+        }
+        else
+        {
+            for (int i = 0; i < 3; i++) {
+                cout << comparison_configs[i].banner << endl;
+                results[i] = run_simulation(contexts[i], comparison_configs[i].use_forwarding,
+                                            comparison_configs[i].use_cache, false);
+            }
+        }
         
-        // Run configuration 3: Forwarding + Cache
-        cout << "[CONFIG 3] Running: With Forwarding + Cache..." << endl;
-        results[2] = run_simulation(true, true, false);
+        delete[] contexts;
         
         // Display comparison table
         display_comparison_table(results);
+        for (int i = 0; i < 3; i++) {
+            if (results[i].hit_cycle_cap) {
+                cerr << "Warning: " << results[i].config_name << " stopped at the " << sweep_spec.max_cycles
+                     << "-cycle cap before HALT (raise --max-cycles)" << endl;
+            }
+        }
         
         // Log to file
         logger1("=== COMPARISON RUN (Assignment IV) ===");
@@ -488,28 +598,108 @@ int main(int argc, char* argv[])
         bool use_fwd = (mode == MODE_FORWARDING_ONLY || mode == MODE_FORWARDING_CACHE);
         bool use_cache = (mode == MODE_FORWARDING_CACHE);
         
+        SimulatorContext *ctx = new SimulatorContext;
+        ctx->program = program;
+        ctx->fast_forward = fast_forward_spec;
+        ctx->max_cycles = sweep_spec.max_cycles;
+        ctx->cache_config = cache_config;
+        ctx->hierarchy_config = sweep_spec.hierarchy;
+        ctx->icache_config = sweep_spec.icache;
+        ctx->pipeline_depth = pipeline_depth;
+        ctx->issue_width = issue_width;
+        ctx->branch_predictor = sweep_spec.predictor[0];
+        
         // Display program
-        initialize_memory();
+        initialize_memory(*ctx);
         cout << "=== TEST PROGRAM ===" << endl;
-        display_program_section();
+        display_program_section(*ctx);
+        
+        // Optional trace files; one that cannot be opened aborts the run
+        PipelineTraceWriter trace_writer;
+        PerfettoTraceWriter *perfetto_writer = nullptr;
+        MemoryTraceWriter mem_trace_writer;
+        bool traces_open = true;
+        if (!trace_path.empty()) {
+            traces_open = open_pipeline_trace(trace_writer, trace_path, *ctx);
+            if (traces_open) {
+                ctx->trace = &trace_writer;
+            }
+        }
+        if (traces_open && !perfetto_path.empty()) {
+            perfetto_writer = new PerfettoTraceWriter;
+            traces_open = open_perfetto_trace(*perfetto_writer, perfetto_path, *ctx);
+            if (traces_open) {
+                ctx->perfetto = perfetto_writer;
+            }
+        }
+        if (traces_open && !mem_trace_path.empty()) {
+            traces_open = open_memory_trace(mem_trace_writer, mem_trace_path);
+            if (traces_open) {
+                ctx->mem_trace = &mem_trace_writer;
+            }
+        }
+        
+        if (traces_open) {
+            run_simulation(*ctx, use_fwd, use_cache, !quiet);
+            if (quiet) {
+                print_results(*ctx);
+            }
+        }
         
-        SimulationResult result = run_simulation(use_fwd, use_cache, true);
+        if (ctx->trace) {
+            uint64_t bytes = close_pipeline_trace(trace_writer);
+            if (traces_open) {
+                cout << "\nTrace: " << trace_writer.cycles << " cycles, " << trace_writer.records
+                     << " records, " << bytes << " bytes -> " << trace_path << endl;
+            }
+            ctx->trace = nullptr;
+        }
+        
+        if (ctx->perfetto) {
+            uint64_t bytes = close_perfetto_trace(*perfetto_writer);
+            if (traces_open) {
+                cout << "\nPerfetto: " << perfetto_writer->events << " events, " << bytes
+                     << " bytes -> " << perfetto_path << endl;
+            }
+            ctx->perfetto = nullptr;
+        }
+        delete perfetto_writer;
+        
+        if (ctx->mem_trace) {
+            uint64_t bytes = close_memory_trace(mem_trace_writer);
+            cout << "\nMemory trace: " << mem_trace_writer.accesses << " accesses, " << bytes
+                 << " bytes -> " << mem_trace_path << endl;
+            ctx->mem_trace = nullptr;
+        }
+        
+        if (!traces_open) {
+            delete ctx;
+            delete program;
+            return 1;
+        }
         
         // Display final state
         cout << "\n========================================" << endl;
         cout << "        EXECUTION COMPLETED" << endl;
         cout << "========================================" << endl;
         
-        display_registers();
+        display_registers(*ctx);
         
         if (use_cache) {
-            display_cache();
-            display_cache_stats();
+            display_cache(*ctx);
+            display_cache_stats(*ctx);
+            if (!heatmap_path.empty() && write_set_heatmap(*ctx, heatmap_path)) {
+                cout << "Set heatmap: " << ctx->cache.sets << " sets -> " << heatmap_path << endl;
+            }
         }
         
-        display_performance();
+        display_performance(*ctx);
+        
+        delete ctx;
     }
     
+    delete program;
+    
     cout << "\n========================================" << endl;
     cout << "        SIMULATION FINISHED" << endl;
     cout << "========================================" << endl;
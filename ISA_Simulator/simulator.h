@@ -0,0 +1,51 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+struct SimulatorContext;
+
+// Structure to store results for comparison
+struct SimulationResult {
+    string config_name;
+    uint64_t cycles;
+    uint64_t instructions;
+    double cpi;
+    double ipc;                     // Instructions per cycle
+    int issue_width;                // Superscalar when above 1
+    uint64_t stalls;
+    uint64_t forwardings;
+    uint64_t flushes;               // Mispredicted JMPs/branches (pipeline flushes)
+    uint64_t branches;              // JMPs and conditional branches resolved
+    uint64_t branch_mispredicts;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t cache_writebacks;      // Dirty blocks written back (write-back cache)
+    uint64_t memory_writes;         // Writes sent to memory by the cache
+    uint64_t write_buffer_stalls;   // Cycles stores waited on a full write buffer
+    uint64_t icache_hits;
+    uint64_t icache_misses;
+    uint64_t mshr_dependency_stalls;    // Cycles instructions waited on pending loads (non-blocking cache)
+    double mlp;                         // Average misses outstanding while any are (non-blocking cache)
+    uint64_t prefetch_issued;
+    uint64_t prefetch_useful;           // Used after the fill completed
+    uint64_t prefetch_late;             // Used while the fill was in flight
+    uint64_t compulsory_misses;         // 3C miss classification
+    uint64_t capacity_misses;
+    uint64_t conflict_misses;
+    uint64_t victim_hits;               // L1 misses served by the victim cache
+    uint64_t fast_forwarded;    // Instructions skipped functionally before timing
+    bool hit_cycle_cap;         // Stopped at max_cycles before HALT
+};
+
+// Run a single simulation with the configuration held in ctx
+// (cache geometry/latency) plus the forwarding and cache switches
+SimulationResult run_simulation(SimulatorContext &ctx, bool use_forwarding, bool use_cache, bool verbose);
+
+// Print the run's counters in the assignment format (to ctx.out)
+void print_results(SimulatorContext &ctx);
+
+#endif // SIMULATOR_H
@@ -0,0 +1,142 @@
+#ifndef SIMULATOR_CONTEXT_H
+#define SIMULATOR_CONTEXT_H
+
+#include <cstdint>
+#include <iostream>
+#include "instruction_memory.h"
+#include "cache.h"
+#include "pipeline.h"
+#include "functional.h"
+
+struct ProgramImage;
+struct PipelineTraceWriter;
+struct PerfettoTraceWriter;
+struct MemoryTraceWriter;
+
+// Simulator Context
+// Holds the complete state of one simulated CPU so that independent
+// configurations can run side by side (one context per thread).
+// Every stage, memory, cache and counter function takes the context it
+// operates on instead of touching file-scope globals.
+struct SimulatorContext
+{
+    // Console output for this run. Parallel runs point this at a private
+    // buffer so their output can be replayed in configuration order.
+    ostream *out = &cout;
+
+    // Register File: R0-R15 (registers.cpp)
+    uint8_t register_file[16];
+
+    // Special Registers
+    uint8_t MAR;        // Memory Address Register
+    uint8_t MDR;        // Memory Data Register
+    uint8_t PC;         // Program Counter
+    bool halt_flag;     // Halt flag
+
+    // Data Memory: 256 x 8-bit (data_memory.cpp)
+    uint8_t data_memory[256];
+
+    // Program copied in by initialize_memory() (shared, read-only);
+    // nullptr selects the built-in test program
+    const ProgramImage *program = nullptr;
+
+    // Functional fast-forward before detailed simulation (functional.cpp)
+    FastForwardSpec fast_forward = { 0, -1 };
+
+    // Detailed simulation limits (simulator.cpp)
+    uint64_t max_cycles = 100;          // Cycle cap for one run
+    uint64_t detail_instructions = 0;   // Stop after this many instructions (0 = until HALT)
+
+    // Binary per-cycle trace of the detailed run, or nullptr (pipeline_trace.h)
+    PipelineTraceWriter *trace = nullptr;
+
+    // Chrome/Perfetto JSON timeline of the detailed run, or nullptr (perfetto_trace.h)
+    PerfettoTraceWriter *perfetto = nullptr;
+
+    // LD/ST address stream of the detailed run, or nullptr (memory_trace.h)
+    MemoryTraceWriter *mem_trace = nullptr;
+
+    // Instruction Memory: 256 packed words (memory.cpp)
+    InstructionWord main_memory[256];
+    DecodedInstruction decoded_program[256];   // Pre-decoded copy (pipeline.cpp)
+    InstructionText memory_text[256];          // Display/logging only
+
+    // Cache configuration, array and counters (cache.cpp)
+    CacheConfig cache_config = { CACHE_LINES, CACHE_HIT_CYCLES, CACHE_MISS_PENALTY,
+                                 CACHE_WAYS, CACHE_BLOCK_SIZE, CACHE_REPLACEMENT,
+                                 CACHE_WRITE_POLICY, CACHE_WRITE_BUFFER, CACHE_MSHRS,
+                                 CACHE_PREFETCHER, VICTIM_LINES, VICTIM_SWAP_CYCLES };
+    Cache cache;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
+    uint64_t cache_stall_cycles;
+    uint64_t cache_writebacks;          // Dirty L1 blocks written back on eviction
+    uint64_t memory_writes;             // Block/byte writes sent to memory
+    uint64_t write_buffer_stalls;       // Cycles waiting on a full write buffer
+    uint64_t write_buffer_coalesced;    // Writes merged into a pending entry
+    uint64_t mshr_merges;               // Misses merged into an outstanding one
+    uint64_t mshr_full_stalls;          // Cycles waiting for a free MSHR
+    uint64_t mshr_dependency_stalls;    // Cycles an instruction waited on a pending load
+    uint64_t mshr_peak;                 // Most misses outstanding at once
+    uint64_t miss_latency_cycles;       // Sum of outstanding fill latencies
+    uint64_t mshr_busy_cycles;          // Cycles with at least one miss outstanding
+    uint64_t mshr_busy_until;           // End of the latest outstanding fill
+    PrefetcherState prefetcher;         // Training state (cache_config.prefetcher)
+    uint64_t prefetch_issued;           // Prefetch fills started
+    uint64_t prefetch_useful;           // Prefetched lines used after their fill completed
+    uint64_t prefetch_late;             // Prefetched lines used while still filling
+    Cache shadow_cache;                 // Fully associative LRU twin of the L1 (3C)
+    uint32_t touched_blocks[8];         // First-touch bitmap, one bit per L1 block
+    uint64_t compulsory_misses;
+    uint64_t capacity_misses;
+    uint64_t conflict_misses;
+    uint64_t set_accesses[MAX_CACHE_LINES];     // Per L1 set (heatmap)
+    uint64_t set_misses[MAX_CACHE_LINES];
+    uint64_t set_conflicts[MAX_CACHE_LINES];
+    Cache victim_cache;                 // Used when cache_config.victim_lines > 0
+    uint64_t victim_hits;               // L1 misses served by the victim cache
+    uint64_t victim_misses;
+    CacheHierarchyConfig hierarchy_config = { 0 };     // L2/L3 behind ctx.cache
+    Cache lower_cache[MAX_CACHE_LEVELS - 1];
+    CacheLevelStats lower_cache_stats[MAX_CACHE_LEVELS - 1];
+    CacheConfig icache_config = { ICACHE_LINES, CACHE_HIT_CYCLES, CACHE_MISS_PENALTY,
+                                  CACHE_WAYS, CACHE_BLOCK_SIZE, CACHE_REPLACEMENT,
+                                  CACHE_WRITE_POLICY, CACHE_WRITE_BUFFER, CACHE_MSHRS,
+                                  PREFETCH_NONE, 0, VICTIM_SWAP_CYCLES };
+    Cache icache;                       // Fetch path, used when icache_config.lines > 0
+    uint64_t icache_hits;
+    uint64_t icache_misses;
+    uint64_t icache_stall_cycles;       // Fetch cycles lost to the I-cache
+
+    // Pipeline state (pipeline.cpp)
+    IFEX_Register ifex_reg;
+    ForwardingUnit forwarding_unit;
+    bool stall_flag;            // Insert stall this cycle
+    bool flush_flag;            // Flush pipeline this cycle
+    int cache_stall_remaining;  // Remaining cache stall cycles
+    int icache_stall_remaining; // Remaining I-cache fetch stall cycles
+    bool icache_filled;         // Fetch at PC already paid its I-cache miss
+    uint64_t reg_ready[16];     // Cycle each register's pending load arrives (non-blocking cache)
+    int pipeline_depth = PIPELINE_DEPTH;    // Stages; 2 runs ifex_reg, deeper runs stage[]
+    PipelineLayout pipeline_layout;
+    int issue_width = ISSUE_WIDTH;          // Instructions per stage group (depth > 2)
+    StageLatch stage[MAX_PIPELINE_DEPTH][MAX_ISSUE_WIDTH];     // Group of each stage, IF first
+    BranchPredictorKind branch_predictor = BRANCH_PREDICTOR;
+    BranchPredictorState branch_state;      // BTB and direction tables
+
+    // Performance Counters (performance.cpp)
+    uint64_t cycle_count;        // Total cycles
+    uint64_t instruction_count;  // Instructions completed
+    uint64_t stall_count;        // Stall cycles
+    uint64_t flush_count;        // Flush operations
+    uint64_t forwarding_count;   // Forwarding operations
+    uint64_t forward_ex_ex;      // Deeper pipelines: operands by forwarding path
+    uint64_t forward_mem_ex;
+    uint64_t forward_wb_id;      // Register file written and read in the same cycle
+    uint64_t branch_count;       // JMPs and conditional branches resolved
+    uint64_t branch_mispredicts; // Of those, fetched down the wrong path
+    uint64_t issue_dependency_splits;   // Superscalar: groups cut by an intra-group dependency
+    uint64_t issue_port_splits;         // ... or by a busy port
+};
+
+#endif // SIMULATOR_CONTEXT_H
@@ -0,0 +1,75 @@
+#include "stack_distance.h"
+
+using namespace std;
+
+// Add delta at position pos (1-based) of the Fenwick tree tree[base + 1 .. base + size]
+static void fenwick_add(vector<int> &tree, size_t base, size_t size, size_t pos, int delta)
+{
+    for (; pos <= size; pos += pos & (~pos + 1))
+        tree[base + pos] += delta;
+}
+
+// Sum of positions 1..pos
+static int fenwick_sum(const vector<int> &tree, size_t base, size_t pos)
+{
+    int sum = 0;
+    for (; pos > 0; pos -= pos & (~pos + 1))
+        sum += tree[base + pos];
+    return sum;
+}
+
+// One pass over records
+void compute_stack_distances(const vector<MemoryTraceRecord> &records, int block_size, int sets,
+                             StackDistanceProfile &profile)
+{
+    int blocks = 256 / block_size;
+    int blocks_per_set = blocks / sets;
+
+    profile.block_size = block_size;
+    profile.sets = sets;
+    profile.accesses = records.size();
+    profile.cold = 0;
+    profile.histogram.assign(sets, vector<uint64_t>(blocks_per_set, 0));
+
+    // Each set's tree covers that set's own accesses, laid out one after
+    // another in a single array
+    vector<size_t> size(sets, 0);
+    for (size_t i = 0; i < records.size(); i++)
+        size[(records[i].address / block_size) % sets]++;
+    vector<size_t> base(sets, 0);
+    for (int s = 1; s < sets; s++)
+        base[s] = base[s - 1] + size[s - 1] + 1;
+    vector<int> tree(base[sets - 1] + size[sets - 1] + 1, 0);
+
+    vector<size_t> now(sets, 0);
+    vector<size_t> last(blocks, 0);     // Set-local position of the block's latest access (0 = never)
+    for (size_t i = 0; i < records.size(); i++)
+    {
+        int block = records[i].address / block_size;
+        int set = block % sets;
+        size_t pos = ++now[set];
+
+        if (last[block] == 0)
+        {
+            profile.cold++;
+        }
+        else
+        {
+            int distance = fenwick_sum(tree, base[set], pos - 1) - fenwick_sum(tree, base[set], last[block]);
+            profile.histogram[set][distance]++;
+            fenwick_add(tree, base[set], size[set], last[block], -1);
+        }
+        fenwick_add(tree, base[set], size[set], pos, 1);
+        last[block] = pos;
+    }
+}
+
+// Misses of an LRU cache with `ways` lines per set
+uint64_t stack_distance_misses(const StackDistanceProfile &profile, int ways)
+{
+    uint64_t misses = profile.cold;
+    for (size_t s = 0; s < profile.histogram.size(); s++)
+        for (size_t d = ways; d < profile.histogram[s].size(); d++)
+            misses += profile.histogram[s][d];
+    return misses;
+}
@@ -0,0 +1,45 @@
+#ifndef STACK_DISTANCE_H
+#define STACK_DISTANCE_H
+
+#include <cstdint>
+#include <vector>
+#include "memory_trace.h"
+
+using namespace std;
+
+/*
+     LRU stack distance (reuse distance) analysis
+     The stack distance of an access is the number of distinct blocks
+     touched since the previous access to the same block. An LRU cache
+     with `ways` lines per set hits exactly when the distance within the
+     block's set is below `ways`, so one pass over a memory trace gives
+     the miss count of every associativity for a given block size and
+     set count (sets = 1 is the fully associative curve for every size).
+     This assumes every access allocates (write-allocate, no write
+     buffer), as cache.cpp does for WRITE_THROUGH without a buffer and
+     for WRITE_BACK.
+
+     Each set gets a Fenwick tree over its own accesses with a 1 at the
+     latest access of each block; the distance is the number of 1s after
+     the block's previous access, so a pass is O(n log n).
+*/
+
+// Per-set distance histograms for one block size and set count
+struct StackDistanceProfile
+{
+    int block_size;
+    int sets;
+    uint64_t accesses = 0;
+    uint64_t cold = 0;                      // First touches (infinite distance)
+    vector<vector<uint64_t> > histogram;    // [set][distance], distance < blocks per set
+};
+
+// One pass over records
+void compute_stack_distances(const vector<MemoryTraceRecord> &records, int block_size, int sets,
+                             StackDistanceProfile &profile);
+
+// Misses of an LRU cache with profile's block size and sets and `ways`
+// lines per set (cold misses plus distances of at least ways)
+uint64_t stack_distance_misses(const StackDistanceProfile &profile, int ways);
+
+#endif // STACK_DISTANCE_H
@@ -0,0 +1,691 @@
+#include "sweep.h"
+#include "simulator.h"
+#include "simulator_context.h"
+#include "cache.h"
+#include "thread_pool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+
+// One point of the cross product
+struct SweepPoint
+{
+    CacheConfig cache;
+    int pipeline_depth;
+    int issue_width;
+    BranchPredictorKind predictor;
+    bool use_forwarding;
+};
+
+// Spec containing only the compiled-in defaults from cache.h
+SweepSpec default_sweep_spec()
+{
+    SweepSpec spec;
+    spec.lines.push_back(CACHE_LINES);
+    spec.ways.push_back(CACHE_WAYS);
+    spec.block_size.push_back(CACHE_BLOCK_SIZE);
+    spec.replacement.push_back(CACHE_REPLACEMENT);
+    spec.write_policy.push_back(CACHE_WRITE_POLICY);
+    spec.write_buffer.push_back(CACHE_WRITE_BUFFER);
+    spec.mshrs.push_back(CACHE_MSHRS);
+    spec.prefetcher.push_back(CACHE_PREFETCHER);
+    spec.victim_lines.push_back(VICTIM_LINES);
+    spec.victim_swap_cycles.push_back(VICTIM_SWAP_CYCLES);
+    spec.hit_cycles.push_back(CACHE_HIT_CYCLES);
+    spec.miss_penalty.push_back(CACHE_MISS_PENALTY);
+    spec.depth.push_back(PIPELINE_DEPTH);
+    spec.width.push_back(ISSUE_WIDTH);
+    spec.predictor.push_back(BRANCH_PREDICTOR);
+    spec.forwarding.push_back(1);
+    spec.max_cycles = 100;
+    spec.hierarchy.lower_levels = 0;
+    CacheConfig icache = { ICACHE_LINES, CACHE_HIT_CYCLES, CACHE_MISS_PENALTY,
+                           CACHE_WAYS, CACHE_BLOCK_SIZE, CACHE_REPLACEMENT,
+                           CACHE_WRITE_POLICY, CACHE_WRITE_BUFFER, CACHE_MSHRS, PREFETCH_NONE,
+                           0, VICTIM_SWAP_CYCLES };
+    spec.icache = icache;
+    return spec;
+}
+
+// Parse a single integer, rejecting trailing garbage and values beyond
+// +-SWEEP_VALUE_MAX
+static bool parse_int(const string &text, int &value)
+{
+    if (text.empty())
+        return false;
+
+    char *end = nullptr;
+    long parsed = strtol(text.c_str(), &end, 10);
+    if (*end != '\0' || parsed > SWEEP_VALUE_MAX || parsed < -SWEEP_VALUE_MAX)
+        return false;
+
+    value = (int)parsed;
+    return true;
+}
+
+// Parse "a", "a,b,c", "a:b" or "a:b:step" into values
+bool parse_sweep_values(const string &text, bool powers_of_two, vector<int> &values)
+{
+    values.clear();
+
+    stringstream items(text);
+    string item;
+    while (getline(items, item, ','))
+    {
+        size_t colon = item.find(':');
+        if (colon == string::npos)
+        {
+            int value;
+            if (!parse_int(item, value))
+                return false;
+            values.push_back(value);
+            continue;
+        }
+
+        // Range a:b[:step]
+        string rest = item.substr(colon + 1);
+        size_t colon2 = rest.find(':');
+        int first, last, step = 1;
+        if (!parse_int(item.substr(0, colon), first))
+            return false;
+        if (!parse_int(rest.substr(0, colon2), last))
+            return false;
+        if (colon2 != string::npos && !parse_int(rest.substr(colon2 + 1), step))
+            return false;
+        if (first > last || step < 1 || (powers_of_two && first < 1))
+            return false;
+
+        if (powers_of_two)
+        {
+            // Stop before doubling past last (no overflow)
+            for (int v = first; ; v *= 2)
+            {
+                values.push_back(v);
+                if (v > last / 2)
+                    break;
+            }
+        }
+        else
+        {
+            if ((last - first) / step + 1 > SWEEP_MAX_VALUES)
+                return false;
+            for (int v = first; v <= last; v += step)
+                values.push_back(v);
+        }
+        if (values.size() > SWEEP_MAX_VALUES)
+            return false;
+    }
+
+    return !values.empty();
+}
+
+// Parse "lru,plru,..." into policies
+bool parse_replacement_values(const string &text, vector<ReplacementPolicy> &values)
+{
+    values.clear();
+
+    stringstream items(text);
+    string item;
+    while (getline(items, item, ','))
+    {
+        ReplacementPolicy policy;
+        if (!parse_replacement_policy(item, policy))
+            return false;
+        values.push_back(policy);
+    }
+
+    return !values.empty();
+}
+
+// Parse "wt,wb" into write policies
+bool parse_write_policy_values(const string &text, vector<WritePolicy> &values)
+{
+    values.clear();
+
+    stringstream items(text);
+    string item;
+    while (getline(items, item, ','))
+    {
+        WritePolicy policy;
+        if (!parse_write_policy(item, policy))
+            return false;
+        values.push_back(policy);
+    }
+
+    return !values.empty();
+}
+
+// Parse "none,next,..." into prefetchers
+bool parse_prefetch_values(const string &text, vector<PrefetchPolicy> &values)
+{
+    values.clear();
+
+    stringstream items(text);
+    string item;
+    while (getline(items, item, ','))
+    {
+        PrefetchPolicy policy;
+        if (!parse_prefetch_policy(item, policy))
+            return false;
+        values.push_back(policy);
+    }
+
+    return !values.empty();
+}
+
+// Parse "none,static,bimodal,gshare,tage" into predictors
+bool parse_branch_predictor_values(const string &text, vector<BranchPredictorKind> &values)
+{
+    values.clear();
+
+    stringstream items(text);
+    string item;
+    while (getline(items, item, ','))
+    {
+        BranchPredictorKind kind;
+        if (!parse_branch_predictor(item, kind))
+            return false;
+        values.push_back(kind);
+    }
+
+    return !values.empty();
+}
+
+// Set one "key=value" cache parameter; false on an unknown key or bad value
+static bool parse_cache_key(const string &key, const string &value, CacheConfig &config)
+{
+    if (key == "lines")
+        return parse_int(value, config.lines);
+    if (key == "ways")
+        return parse_int(value, config.ways);
+    if (key == "block")
+        return parse_int(value, config.block_size);
+    if (key == "hit")
+        return parse_int(value, config.hit_cycles);
+    if (key == "penalty")
+        return parse_int(value, config.miss_penalty);
+    if (key == "policy")
+        return parse_replacement_policy(value, config.replacement);
+    return false;
+}
+
+// Split "key=value,..." and hand each pair to parse_cache_key, except
+// "inclusion" when inclusion is not nullptr
+static bool parse_cache_items(const string &text, CacheConfig &config, InclusionPolicy *inclusion)
+{
+    stringstream items(text);
+    string item;
+    while (getline(items, item, ','))
+    {
+        size_t equals = item.find('=');
+        if (equals == string::npos)
+            return false;
+        string key = item.substr(0, equals);
+        string value = item.substr(equals + 1);
+
+        bool ok;
+        if (key == "inclusion" && inclusion != nullptr)
+            ok = parse_inclusion_policy(value, *inclusion);
+        else
+            ok = parse_cache_key(key, value, config);
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+// Parse a cache "key=value,..." over config
+bool parse_cache_spec(const string &text, CacheConfig &config)
+{
+    return parse_cache_items(text, config, nullptr);
+}
+
+// Parse a lower cache level "key=value,..."
+bool parse_cache_level(const string &text, CacheLevelConfig &level)
+{
+    CacheConfig cache = { LOWER_CACHE_LINES, LOWER_CACHE_HIT_CYCLES, CACHE_MISS_PENALTY,
+                          LOWER_CACHE_WAYS, CACHE_BLOCK_SIZE, CACHE_REPLACEMENT,
+                          CACHE_WRITE_POLICY, CACHE_WRITE_BUFFER, CACHE_MSHRS, PREFETCH_NONE,
+                          0, VICTIM_SWAP_CYCLES };
+    level.cache = cache;
+    level.inclusion = INCLUSION_NINE;
+    return parse_cache_items(text, level.cache, &level.inclusion);
+}
+
+// Cache configuration from the first value of each list
+CacheConfig first_cache_config(const SweepSpec &spec)
+{
+    CacheConfig config = { spec.lines[0], spec.hit_cycles[0], spec.miss_penalty[0],
+                           spec.ways[0], spec.block_size[0], spec.replacement[0],
+                           spec.write_policy[0], spec.write_buffer[0], spec.mshrs[0],
+                           spec.prefetcher[0], spec.victim_lines[0], spec.victim_swap_cycles[0] };
+    return config;
+}
+
+// Multiply count by a list size; false once the product would exceed
+// SWEEP_MAX_POINTS (checked before multiplying, so it cannot wrap)
+static bool multiply_points(size_t &count, size_t values)
+{
+    if (values > 0 && count > SWEEP_MAX_POINTS / values)
+        return false;
+    count *= values;
+    return true;
+}
+
+// Number of cache configurations in the cross product
+static bool cache_config_count(const SweepSpec &spec, size_t &count)
+{
+    count = 1;
+    return multiply_points(count, spec.lines.size()) &&
+           multiply_points(count, spec.ways.size()) &&
+           multiply_points(count, spec.block_size.size()) &&
+           multiply_points(count, spec.replacement.size()) &&
+           multiply_points(count, spec.write_policy.size()) &&
+           multiply_points(count, spec.write_buffer.size()) &&
+           multiply_points(count, spec.mshrs.size()) &&
+           multiply_points(count, spec.prefetcher.size()) &&
+           multiply_points(count, spec.victim_lines.size()) &&
+           multiply_points(count, spec.victim_swap_cycles.size()) &&
+           multiply_points(count, spec.hit_cycles.size()) &&
+           multiply_points(count, spec.miss_penalty.size());
+}
+
+// Number of depth/width pairs that can run (widths above 1 need depth > 2)
+static size_t pipeline_pair_count(const SweepSpec &spec)
+{
+    size_t pairs = 0;
+    for (size_t k = 0; k < spec.depth.size(); k++)
+        for (size_t w = 0; w < spec.width.size(); w++)
+            if (is_valid_issue_width(spec.width[w], spec.depth[k]))
+                pairs++;
+    return pairs;
+}
+
+// Replace configs by their cross product with values of field
+template <class T>
+static void cross_field(vector<CacheConfig> &configs, const vector<T> &values, T CacheConfig::*field)
+{
+    vector<CacheConfig> crossed;
+    crossed.reserve(configs.size() * values.size());
+    for (size_t i = 0; i < configs.size(); i++)
+        for (size_t v = 0; v < values.size(); v++)
+        {
+            CacheConfig config = configs[i];
+            config.*field = values[v];
+            crossed.push_back(config);
+        }
+    configs.swap(crossed);
+}
+
+// Every cache configuration of the cross product, lines outermost,
+// including geometries that cannot exist
+static void cross_cache_configs(const SweepSpec &spec, vector<CacheConfig> &configs)
+{
+    configs.clear();
+    configs.push_back(first_cache_config(spec));
+    cross_field(configs, spec.lines, &CacheConfig::lines);
+    cross_field(configs, spec.ways, &CacheConfig::ways);
+    cross_field(configs, spec.block_size, &CacheConfig::block_size);
+    cross_field(configs, spec.replacement, &CacheConfig::replacement);
+    cross_field(configs, spec.write_policy, &CacheConfig::write_policy);
+    cross_field(configs, spec.write_buffer, &CacheConfig::write_buffer);
+    cross_field(configs, spec.mshrs, &CacheConfig::mshrs);
+    cross_field(configs, spec.prefetcher, &CacheConfig::prefetcher);
+    cross_field(configs, spec.victim_lines, &CacheConfig::victim_lines);
+    cross_field(configs, spec.victim_swap_cycles, &CacheConfig::victim_swap_cycles);
+    cross_field(configs, spec.hit_cycles, &CacheConfig::hit_cycles);
+    cross_field(configs, spec.miss_penalty, &CacheConfig::miss_penalty);
+}
+
+// Remove the configurations that are invalid or do not fit in front of
+// spec.hierarchy; returns how many were removed
+static size_t drop_impossible_configs(const SweepSpec &spec, vector<CacheConfig> &configs)
+{
+    size_t kept = 0;
+    for (size_t i = 0; i < configs.size(); i++)
+        if (is_valid_cache_config(configs[i]) && is_valid_cache_hierarchy(configs[i], spec.hierarchy))
+            configs[kept++] = configs[i];
+    size_t dropped = configs.size() - kept;
+    configs.resize(kept);
+    return dropped;
+}
+
+// Power of two within 1..max
+static bool is_power_of_two_upto(int value, int max)
+{
+    return value >= 1 && value <= max && (value & (value - 1)) == 0;
+}
+
+// Reject a value that is invalid whatever it is combined with
+template <class T>
+static bool check_values(const vector<T> &values, bool (*valid)(T), const char *name)
+{
+    for (size_t i = 0; i < values.size(); i++)
+        if (!valid(values[i]))
+        {
+            cerr << "Invalid " << name << " value: " << values[i] << endl;
+            return false;
+        }
+    return true;
+}
+
+static bool valid_lines(int v) { return is_power_of_two_upto(v, MAX_CACHE_LINES); }
+static bool valid_block(int v) { return is_power_of_two_upto(v, MAX_CACHE_BYTES); }
+static bool valid_write_buffer(int v) { return v >= 0 && v <= MAX_WRITE_BUFFER; }
+static bool valid_mshrs(int v) { return v >= 0 && v <= MAX_MSHRS; }
+static bool valid_victim_lines(int v) { return v >= 0 && v <= MAX_VICTIM_LINES; }
+static bool valid_cycles(int v) { return v >= 1; }
+
+// Check every cache value on its own; only their combinations (more ways
+// than lines, more than MAX_CACHE_BYTES) are left to be skipped
+static bool check_cache_values(const SweepSpec &spec)
+{
+    return check_values(spec.lines, valid_lines, "cache lines") &&
+           check_values(spec.ways, valid_lines, "cache ways") &&
+           check_values(spec.block_size, valid_block, "block size") &&
+           check_values(spec.write_buffer, valid_write_buffer, "write buffer") &&
+           check_values(spec.mshrs, valid_mshrs, "MSHR") &&
+           check_values(spec.victim_lines, valid_victim_lines, "victim cache lines") &&
+           check_values(spec.victim_swap_cycles, valid_cycles, "victim swap cycles") &&
+           check_values(spec.hit_cycles, valid_cycles, "hit cycles") &&
+           check_values(spec.miss_penalty, valid_cycles, "miss penalty");
+}
+
+// Every valid cache configuration of the cross product, lines outermost
+bool expand_cache_configs(const SweepSpec &spec, vector<CacheConfig> &configs, size_t &skipped)
+{
+    configs.clear();
+    skipped = 0;
+    if (spec.icache.lines > 0 && !is_valid_cache_config(spec.icache))
+    {
+        cerr << "Invalid I-cache config: " << describe_cache_config(spec.icache) << endl;
+        return false;
+    }
+
+    size_t count;
+    if (!cache_config_count(spec, count))
+    {
+        cerr << "Too many cache configurations (limit " << SWEEP_MAX_POINTS << ")" << endl;
+        return false;
+    }
+    if (!check_cache_values(spec))
+        return false;
+
+    // The lower levels on their own, behind an L1 with the L2's block size
+    if (spec.hierarchy.lower_levels > 0)
+    {
+        CacheConfig l1 = first_cache_config(spec);
+        l1.block_size = spec.hierarchy.level[0].cache.block_size;
+        if (!is_valid_cache_hierarchy(l1, spec.hierarchy))
+        {
+            cerr << "Invalid cache hierarchy: " << describe_cache_level(spec.hierarchy.level[0]) << endl;
+            return false;
+        }
+    }
+
+    cross_cache_configs(spec, configs);
+    skipped = drop_impossible_configs(spec, configs);
+    if (configs.empty())
+    {
+        cerr << "No cache configuration in the sweep can exist (ways <= lines, lines * block <= "
+             << MAX_CACHE_BYTES << " bytes, blocks no larger than the L2's)" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Number of points in the full cross product, skipped ones included
+static bool full_point_count(const SweepSpec &spec, size_t &count)
+{
+    return cache_config_count(spec, count) &&
+           multiply_points(count, spec.depth.size()) &&
+           multiply_points(count, spec.width.size()) &&
+           multiply_points(count, spec.predictor.size()) &&
+           multiply_points(count, spec.forwarding.size());
+}
+
+// Number of points that run: valid cache configurations times runnable
+// depth/width pairs times predictors times forwarding settings
+bool sweep_point_count(const SweepSpec &spec, size_t &count)
+{
+    if (!full_point_count(spec, count))
+        return false;
+
+    vector<CacheConfig> configs;
+    cross_cache_configs(spec, configs);
+    drop_impossible_configs(spec, configs);
+    count = configs.size();
+    return multiply_points(count, pipeline_pair_count(spec)) &&
+           multiply_points(count, spec.predictor.size()) &&
+           multiply_points(count, spec.forwarding.size());
+}
+
+// Write the header row (CSV only)
+static void write_sweep_header(SweepFormat format, ostream &out)
+{
+    if (format == SWEEP_CSV)
+        out << "lines,ways,block_size,replacement,write_policy,write_buffer,mshrs,prefetcher,"
+               "victim_lines,victim_swap,hit_cycles,miss_penalty,depth,width,predictor,"
+               "forwarding,cycles,instructions,cpi,ipc,slot_utilization,stalls,forwardings,flushes,branches,mispredicts,"
+               "cache_hits,cache_misses,"
+               "cache_writebacks,memory_writes,write_buffer_stalls,icache_hits,icache_misses,"
+               "dependency_stalls,mlp,prefetch_issued,prefetch_useful,prefetch_late,"
+               "compulsory_misses,capacity_misses,conflict_misses,victim_hits\n";
+}
+
+// Write one row for a finished point
+static void write_sweep_row(SweepFormat format, const SweepPoint &p,
+                            const SimulationResult &r, ostream &out)
+{
+    char cpi[32], ipc[32], utilization[32], mlp[32];
+    snprintf(cpi, sizeof(cpi), "%.4f", r.cpi);
+    snprintf(ipc, sizeof(ipc), "%.4f", r.ipc);
+    snprintf(utilization, sizeof(utilization), "%.4f", r.ipc / r.issue_width);
+    snprintf(mlp, sizeof(mlp), "%.4f", r.mlp);
+
+    if (format == SWEEP_CSV)
+    {
+        out << p.cache.lines << ',' << p.cache.ways << ',' << p.cache.block_size << ','
+            << replacement_policy_name(p.cache.replacement) << ','
+            << write_policy_name(p.cache.write_policy) << ',' << p.cache.write_buffer << ','
+            << p.cache.mshrs << ',' << prefetch_policy_name(p.cache.prefetcher) << ','
+            << p.cache.victim_lines << ',' << p.cache.victim_swap_cycles << ','
+            << p.cache.hit_cycles << ',' << p.cache.miss_penalty << ','
+            << p.pipeline_depth << ',' << p.issue_width << ','
+            << branch_predictor_name(p.predictor) << ','
+            << (p.use_forwarding ? 1 : 0) << ','
+            << r.cycles << ',' << r.instructions << ',' << cpi << ','
+            << ipc << ',' << utilization << ','
+            << r.stalls << ',' << r.forwardings << ',' << r.flushes << ','
+            << r.branches << ',' << r.branch_mispredicts << ','
+            << r.cache_hits << ',' << r.cache_misses << ','
+            << r.cache_writebacks << ',' << r.memory_writes << ',' << r.write_buffer_stalls << ','
+            << r.icache_hits << ',' << r.icache_misses << ','
+            << r.mshr_dependency_stalls << ',' << mlp << ','
+            << r.prefetch_issued << ',' << r.prefetch_useful << ',' << r.prefetch_late << ','
+            << r.compulsory_misses << ',' << r.capacity_misses << ',' << r.conflict_misses << ','
+            << r.victim_hits << '\n';
+    }
+    else
+    {
+        out << "{\"lines\":" << p.cache.lines
+            << ",\"ways\":" << p.cache.ways
+            << ",\"block_size\":" << p.cache.block_size
+            << ",\"replacement\":\"" << replacement_policy_name(p.cache.replacement) << '"'
+            << ",\"write_policy\":\"" << write_policy_name(p.cache.write_policy) << '"'
+            << ",\"write_buffer\":" << p.cache.write_buffer
+            << ",\"mshrs\":" << p.cache.mshrs
+            << ",\"prefetcher\":\"" << prefetch_policy_name(p.cache.prefetcher) << '"'
+            << ",\"victim_lines\":" << p.cache.victim_lines
+            << ",\"victim_swap\":" << p.cache.victim_swap_cycles
+            << ",\"hit_cycles\":" << p.cache.hit_cycles
+            << ",\"miss_penalty\":" << p.cache.miss_penalty
+            << ",\"depth\":" << p.pipeline_depth
+            << ",\"width\":" << p.issue_width
+            << ",\"predictor\":\"" << branch_predictor_name(p.predictor) << '"'
+            << ",\"forwarding\":" << (p.use_forwarding ? "true" : "false")
+            << ",\"cycles\":" << r.cycles
+            << ",\"instructions\":" << r.instructions
+            << ",\"cpi\":" << cpi
+            << ",\"ipc\":" << ipc
+            << ",\"slot_utilization\":" << utilization
+            << ",\"stalls\":" << r.stalls
+            << ",\"forwardings\":" << r.forwardings
+            << ",\"flushes\":" << r.flushes
+            << ",\"branches\":" << r.branches
+            << ",\"mispredicts\":" << r.branch_mispredicts
+            << ",\"cache_hits\":" << r.cache_hits
+            << ",\"cache_misses\":" << r.cache_misses
+            << ",\"cache_writebacks\":" << r.cache_writebacks
+            << ",\"memory_writes\":" << r.memory_writes
+            << ",\"write_buffer_stalls\":" << r.write_buffer_stalls
+            << ",\"icache_hits\":" << r.icache_hits
+            << ",\"icache_misses\":" << r.icache_misses
+            << ",\"dependency_stalls\":" << r.mshr_dependency_stalls
+            << ",\"mlp\":" << mlp
+            << ",\"prefetch_issued\":" << r.prefetch_issued
+            << ",\"prefetch_useful\":" << r.prefetch_useful
+            << ",\"prefetch_late\":" << r.prefetch_late
+            << ",\"compulsory_misses\":" << r.compulsory_misses
+            << ",\"capacity_misses\":" << r.capacity_misses
+            << ",\"conflict_misses\":" << r.conflict_misses
+            << ",\"victim_hits\":" << r.victim_hits << "}\n";
+    }
+}
+
+// Reject sweeps with more than SWEEP_MAX_POINTS points
+static bool check_point_count(const SweepSpec &spec, size_t &count)
+{
+    if (!sweep_point_count(spec, count))
+    {
+        cerr << "Too many design points (limit " << SWEEP_MAX_POINTS << ")" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Reject invalid pipeline depths and issue widths, and sweeps in which
+// no depth/width pair can run
+static bool check_pipeline_values(const SweepSpec &spec)
+{
+    PipelineLayout layout;
+    for (size_t k = 0; k < spec.depth.size(); k++)
+    {
+        if (!configure_pipeline_layout(spec.depth[k], layout))
+        {
+            cerr << "Invalid pipeline depth: " << spec.depth[k] << endl;
+            return false;
+        }
+    }
+    for (size_t w = 0; w < spec.width.size(); w++)
+    {
+        if (!is_valid_issue_width(spec.width[w], MAX_PIPELINE_DEPTH))
+        {
+            cerr << "Invalid issue width: " << spec.width[w] << endl;
+            return false;
+        }
+    }
+    if (pipeline_pair_count(spec) == 0)
+    {
+        cerr << "No issue width in the sweep runs at its pipeline depths "
+                "(widths above 1 need depth > 2)" << endl;
+        return false;
+    }
+    return true;
+}
+
+// Check everything run_sweep() would reject, without running anything
+bool validate_sweep(const SweepSpec &spec)
+{
+    size_t count, skipped;
+    vector<CacheConfig> configs;
+    return check_point_count(spec, count) && expand_cache_configs(spec, configs, skipped) &&
+           check_pipeline_values(spec);
+}
+
+// Run every point on the work-stealing pool and write one row per point
+bool run_sweep(const SweepSpec &spec, const ProgramImage *program,
+               const FastForwardSpec &fast_forward, unsigned int jobs,
+               SweepFormat format, ostream &out)
+{
+    // Expand the cross product
+    size_t count, skipped_configs;
+    vector<CacheConfig> configs;
+    if (!check_point_count(spec, count) || !expand_cache_configs(spec, configs, skipped_configs) ||
+        !check_pipeline_values(spec))
+        return false;
+
+    // Cache geometries that cannot exist were dropped by
+    // expand_cache_configs(); widths above 1 at depth 2 have no ID stage
+    // to issue from. Both are left out rather than failing the whole sweep
+    vector<SweepPoint> points;
+    points.reserve(count);
+    for (size_t c = 0; c < configs.size(); c++)
+        for (size_t k = 0; k < spec.depth.size(); k++)
+            for (size_t w = 0; w < spec.width.size(); w++)
+            {
+                if (!is_valid_issue_width(spec.width[w], spec.depth[k]))
+                    continue;
+                for (size_t b = 0; b < spec.predictor.size(); b++)
+                    for (size_t d = 0; d < spec.forwarding.size(); d++)
+                    {
+                        SweepPoint p;
+                        p.cache = configs[c];
+                        p.pipeline_depth = spec.depth[k];
+                        p.issue_width = spec.width[w];
+                        p.predictor = spec.predictor[b];
+                        p.use_forwarding = spec.forwarding[d] != 0;
+                        points.push_back(p);
+                    }
+            }
+    size_t full;
+    full_point_count(spec, full);
+    if (points.size() < full)
+        cerr << "Warning: skipped " << full - points.size() << " of " << full
+             << " points whose cache geometry or depth/width pair cannot exist" << endl;
+
+    vector<SimulationResult> results(points.size());
+
+    {
+        ThreadPool pool(jobs);
+        for (size_t i = 0; i < points.size(); i++)
+        {
+            pool.submit([&points, &results, &spec, &fast_forward, program, i]() {
+                // Per-run console output is discarded
+                ostream discard(nullptr);
+                SimulatorContext *ctx = new SimulatorContext;
+                ctx->out = &discard;
+                ctx->cache_config = points[i].cache;
+                ctx->pipeline_depth = points[i].pipeline_depth;
+                ctx->issue_width = points[i].issue_width;
+                ctx->branch_predictor = points[i].predictor;
+                ctx->hierarchy_config = spec.hierarchy;
+                ctx->icache_config = spec.icache;
+                ctx->program = program;
+                ctx->fast_forward = fast_forward;
+                ctx->max_cycles = spec.max_cycles;
+
+                results[i] = run_simulation(*ctx, points[i].use_forwarding, true, false);
+                delete ctx;
+            });
+        }
+        pool.wait_all();
+    }
+
+    write_sweep_header(format, out);
+    size_t capped = 0;
+    for (size_t i = 0; i < points.size(); i++)
+    {
+        write_sweep_row(format, points[i], results[i], out);
+        if (results[i].hit_cycle_cap)
+            capped++;
+    }
+    if (capped > 0)
+        cerr << "Warning: " << capped << " of " << points.size() << " points stopped at the "
+             << spec.max_cycles << "-cycle cap before HALT (raise --max-cycles)" << endl;
+
+    return true;
+}
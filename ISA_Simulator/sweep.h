@@ -0,0 +1,124 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "cache.h"
+#include "branch_predictor.h"
+
+using namespace std;
+
+struct ProgramImage;
+struct FastForwardSpec;
+
+// Design-Space Sweep
+// Runs the cross product of cache geometry/latency, pipeline depth,
+// issue width, branch predictor and forwarding settings without recompiling. Each point is an independent
+// run_simulation() on its own SimulatorContext, scheduled on the
+// work-stealing ThreadPool; rows are written in point order.
+
+// Parameter values to sweep (each list must be non-empty)
+struct SweepSpec
+{
+    vector<int> lines;          // CACHE_LINES values (powers of two)
+    vector<int> ways;           // CACHE_WAYS values (powers of two)
+    vector<int> block_size;     // CACHE_BLOCK_SIZE values (powers of two)
+    vector<ReplacementPolicy> replacement;
+    vector<WritePolicy> write_policy;
+    vector<int> write_buffer;   // Write buffer entries (0 = none)
+    vector<int> mshrs;          // Outstanding misses (0 = blocking cache)
+    vector<PrefetchPolicy> prefetcher;
+    vector<int> victim_lines;   // Victim cache lines (0 = none)
+    vector<int> victim_swap_cycles;
+    vector<int> hit_cycles;     // CACHE_HIT_CYCLES values
+    vector<int> miss_penalty;   // CACHE_MISS_PENALTY values
+    vector<int> depth;          // Pipeline stages (2..MAX_PIPELINE_DEPTH)
+    vector<int> width;          // Issue width (1..MAX_ISSUE_WIDTH, above 1 needs depth > 2)
+    vector<BranchPredictorKind> predictor;
+    vector<int> forwarding;     // 0 = forwarding off, 1 = on
+    uint64_t max_cycles;        // Cycle cap of every point
+    CacheHierarchyConfig hierarchy;     // L2/L3, the same for every point
+    CacheConfig icache;                 // I-cache (lines 0 = none), the same for every point
+};
+
+// Output row format
+enum SweepFormat
+{
+    SWEEP_CSV,      // Header line + one comma-separated row per point
+    SWEEP_JSON      // One JSON object per line (JSON Lines)
+};
+
+// Spec containing only the compiled-in defaults from cache.h
+SweepSpec default_sweep_spec();
+
+// Parse "a", "a,b,c", "a:b" or "a:b:step" into values.
+// With powers_of_two, "a:b" walks a, 2a, 4a ... up to b.
+// Returns false on malformed input, a value beyond +-SWEEP_VALUE_MAX or
+// more than SWEEP_MAX_VALUES values.
+#define SWEEP_VALUE_MAX 1000000
+#define SWEEP_MAX_VALUES 4096
+bool parse_sweep_values(const string &text, bool powers_of_two, vector<int> &values);
+
+// Parse "lru,plru,..." into policies; false on an unknown name
+bool parse_replacement_values(const string &text, vector<ReplacementPolicy> &values);
+
+// Parse "wt,wb" into write policies; false on an unknown name
+bool parse_write_policy_values(const string &text, vector<WritePolicy> &values);
+
+// Parse "none,next,stride,stream" into prefetchers; false on an unknown name
+bool parse_prefetch_values(const string &text, vector<PrefetchPolicy> &values);
+
+// Parse "none,static,bimodal,gshare,tage" into predictors; false on an unknown name
+bool parse_branch_predictor_values(const string &text, vector<BranchPredictorKind> &values);
+
+// Parse a cache "lines=N,ways=N,block=N,hit=N,penalty=N,policy=P" (any
+// subset) over the values already in config (I-cache).
+// Returns false on an unknown key or malformed value.
+bool parse_cache_spec(const string &text, CacheConfig &config);
+
+// Parse a lower cache level "lines=N,ways=N,block=N,hit=N,inclusion=I,policy=P"
+// (any subset; missing keys take the LOWER_CACHE_* and cache.h defaults).
+// Returns false on an unknown key or malformed value.
+bool parse_cache_level(const string &text, CacheLevelConfig &level);
+
+// Cache configuration from the first value of each list (single runs)
+CacheConfig first_cache_config(const SweepSpec &spec);
+
+// Every valid cache configuration of the cross product, lines outermost.
+// Combinations that cannot exist (more ways than lines, more than
+// MAX_CACHE_BYTES, blocks that do not fit spec.hierarchy) are left out
+// and counted in skipped. Returns false (printing the problem) if a value
+// is invalid on its own, spec.hierarchy or spec.icache is invalid, no
+// configuration is left, or there are more than SWEEP_MAX_POINTS
+// configurations before skipping.
+bool expand_cache_configs(const SweepSpec &spec, vector<CacheConfig> &configs, size_t &skipped);
+
+// Number of points that run, leaving out cache geometries and depth/width
+// pairs that cannot exist. Returns false if the full cross product
+// (skipped points included) exceeds SWEEP_MAX_POINTS.
+#define SWEEP_MAX_POINTS 1000000
+bool sweep_point_count(const SweepSpec &spec, size_t &count);
+
+// Check the point count, cache values, pipeline depths and issue widths
+// of spec, printing the first problem. run_sweep() fails exactly when
+// this does, so callers can validate before opening their output.
+bool validate_sweep(const SweepSpec &spec);
+
+// Run every point on a pool of `jobs` workers (0 = one per hardware
+// thread) and write one row per point to out. program may be nullptr
+// for the built-in test program; every point fast-forwards per
+// fast_forward before its detailed run.
+// Points whose cache geometry cannot exist, or with issue width above 1
+// at depth 2, are skipped with a warning. Returns false (writing nothing)
+// if the full cross product exceeds SWEEP_MAX_POINTS, a cache value,
+// pipeline depth or issue width is invalid on its own, or no cache
+// configuration or no depth/width pair can run. Points that stop at
+// spec.max_cycles before HALT are reported on cerr.
+bool run_sweep(const SweepSpec &spec, const ProgramImage *program,
+               const FastForwardSpec &fast_forward, unsigned int jobs,
+               SweepFormat format, ostream &out);
+
+#endif // SWEEP_H
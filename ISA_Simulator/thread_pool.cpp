@@ -0,0 +1,132 @@
+#include "thread_pool.h"
+
+using namespace std;
+
+// Identifies the pool and deque of the calling worker thread, so tasks
+// submitted from inside a task land on the submitting worker's own deque
+static thread_local ThreadPool *current_pool = nullptr;
+static thread_local unsigned int current_worker = 0;
+
+// Start the worker threads
+ThreadPool::ThreadPool(unsigned int num_threads)
+    : next_queue(0), queued(0), pending(0), stopping(false)
+{
+    if (num_threads == 0)
+        num_threads = thread::hardware_concurrency();
+    if (num_threads == 0)
+        num_threads = 1;
+
+    for (unsigned int i = 0; i < num_threads; i++)
+        queues.push_back(unique_ptr<WorkQueue>(new WorkQueue));
+
+    for (unsigned int i = 0; i < num_threads; i++)
+        workers.push_back(thread(&ThreadPool::worker_loop, this, i));
+}
+
+// Drain remaining tasks and join all workers
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(state_mutex);
+        stopping = true;
+    }
+    task_available.notify_all();
+
+    for (size_t i = 0; i < workers.size(); i++)
+        workers[i].join();
+}
+
+// Queue a task for execution on a worker
+void ThreadPool::submit(function<void()> task)
+{
+    unsigned int target;
+    if (current_pool == this)
+        target = current_worker;
+    else
+        target = next_queue++ % queues.size();
+
+    // Count the task before it becomes visible so queued never underflows
+    {
+        lock_guard<mutex> lock(state_mutex);
+        queued++;
+        pending++;
+    }
+
+    {
+        lock_guard<mutex> lock(queues[target]->lock);
+        queues[target]->tasks.push_back(task);
+    }
+    task_available.notify_one();
+}
+
+// Block until every submitted task has finished
+void ThreadPool::wait_all()
+{
+    unique_lock<mutex> lock(state_mutex);
+    all_done.wait(lock, [this] { return pending == 0; });
+}
+
+// Number of worker threads
+unsigned int ThreadPool::size() const
+{
+    return (unsigned int)workers.size();
+}
+
+// Take the newest task from this worker's own deque
+bool ThreadPool::pop_local(unsigned int index, function<void()> &task)
+{
+    WorkQueue &q = *queues[index];
+    lock_guard<mutex> lock(q.lock);
+    if (q.tasks.empty())
+        return false;
+
+    task = q.tasks.back();
+    q.tasks.pop_back();
+    return true;
+}
+
+// Take the oldest task from another worker's deque
+bool ThreadPool::steal(unsigned int thief, function<void()> &task)
+{
+    size_t n = queues.size();
+    for (size_t offset = 1; offset < n; offset++)
+    {
+        WorkQueue &victim = *queues[(thief + offset) % n];
+        lock_guard<mutex> lock(victim.lock);
+        if (victim.tasks.empty())
+            continue;
+
+        task = victim.tasks.front();
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+// Worker: run own tasks, steal when idle, sleep when every deque is empty
+void ThreadPool::worker_loop(unsigned int index)
+{
+    current_pool = this;
+    current_worker = index;
+
+    while (true)
+    {
+        function<void()> task;
+        if (pop_local(index, task) || steal(index, task))
+        {
+            queued--;
+            task();
+
+            lock_guard<mutex> lock(state_mutex);
+            pending--;
+            if (pending == 0)
+                all_done.notify_all();
+            continue;
+        }
+
+        unique_lock<mutex> lock(state_mutex);
+        task_available.wait(lock, [this] { return stopping || queued > 0; });
+        if (stopping && queued == 0)
+            return;  // stopping and nothing left to run
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Work-stealing worker pool
+// Every worker owns a task deque. Workers pop their own deque from the
+// back (most recently queued first) and, when it runs dry, steal from the
+// front of the other workers' deques, so uneven task lengths (e.g. sweep
+// points with very different miss penalties) still keep all cores busy.
+// Each task runs one independent simulation on its own SimulatorContext,
+// so tasks never share simulator state and need no further locking.
+class ThreadPool
+{
+public:
+    // num_threads = 0 selects one worker per hardware thread
+    explicit ThreadPool(unsigned int num_threads = 0);
+    ~ThreadPool();
+
+    // Queue a task for execution on a worker
+    void submit(function<void()> task);
+
+    // Block until every submitted task has finished
+    void wait_all();
+
+    // Number of worker threads
+    unsigned int size() const;
+
+private:
+    // Per-worker task deque
+    struct WorkQueue
+    {
+        mutex lock;
+        deque<function<void()>> tasks;
+    };
+
+    void worker_loop(unsigned int index);
+    bool pop_local(unsigned int index, function<void()> &task);
+    bool steal(unsigned int thief, function<void()> &task);
+
+    vector<thread> workers;
+    vector<unique_ptr<WorkQueue>> queues;
+    atomic<unsigned int> next_queue;    // Round-robin target for external submits
+    atomic<size_t> queued;              // Tasks sitting in any deque
+
+    mutex state_mutex;
+    condition_variable task_available;
+    condition_variable all_done;
+    size_t pending;     // Tasks queued or running
+    bool stopping;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,266 @@
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include "pipeline_trace.h"
+#include "program_loader.h"
+
+using namespace std;
+
+// Offline decoder for binary pipeline traces (pipeline_trace.h)
+//
+//      trace_decode trace.bin [--csv] [-o out]
+//
+// Text output reproduces the pipeline.txt format, one line per cycle:
+//      [YYYY-MM-DD HH:MM:SS] CYCLE: 001 | IF: <instruction> | EX: <instruction> | STATUS: ...
+// CSV output has one row per cycle with the raw fields.
+
+// Buffered sequential reader over the record section
+struct TraceReader
+{
+    FILE *file;
+    uint64_t remaining;         // Record bytes not yet read
+    unsigned char buffer[1 << 16];
+    size_t pos;
+    size_t len;
+};
+
+static bool next_byte(TraceReader &reader, uint8_t &byte)
+{
+    if (reader.pos == reader.len)
+    {
+        if (reader.remaining == 0)
+            return false;
+        size_t want = reader.remaining < sizeof(reader.buffer) ? (size_t)reader.remaining : sizeof(reader.buffer);
+        reader.len = fread(reader.buffer, 1, want, reader.file);
+        reader.pos = 0;
+        reader.remaining -= reader.len;
+        if (reader.len == 0)
+            return false;
+    }
+    byte = reader.buffer[reader.pos++];
+    return true;
+}
+
+// Read one record and its cycle delta
+static bool read_record(TraceReader &reader, PipelineTraceRecord &record, uint64_t &delta)
+{
+    uint8_t bytes[4];
+    for (int i = 0; i < 4; i++)
+        if (!next_byte(reader, bytes[i]))
+            return false;
+
+    record.status = bytes[0] & ~TRACE_DELTA;
+    record.if_pc = bytes[1];
+    record.ex_pc = bytes[2];
+    record.opcodes = bytes[3];
+
+    delta = 1;
+    if (bytes[0] & TRACE_DELTA)
+    {
+        delta = 0;
+        int shift = 0;
+        uint8_t byte;
+        do
+        {
+            if (!next_byte(reader, byte))
+                return false;
+            delta |= (uint64_t)(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+    }
+    return true;
+}
+
+// Instruction text for a stage, as the simulator disassembles it
+static string stage_text(const PipelineTraceHeader &header, bool valid, uint8_t pc, uint8_t opcode)
+{
+    if (!valid)
+        return "EMPTY";
+
+    InstructionWord word = header.words[pc];
+    string instruction, mnemonic;
+    disassemble(pack_instruction(opcode, instruction_register(word), instruction_data(word)),
+                instruction, mnemonic);
+    return instruction;
+}
+
+// Fixed-width, zero-padded field as written by log_pipeline()
+static string padded(const string &text)
+{
+    string field = text;
+    if (field.size() < 20)
+        field.append(20 - field.size(), '0');
+    return field;
+}
+
+static string status_text(uint8_t status)
+{
+    static const struct { uint8_t bit; const char *name; } names[] = {
+        { TRACE_STALL, "STALL" }, { TRACE_FLUSH, "FLUSH" }, { TRACE_FORWARD, "FORWARD" },
+        { TRACE_CACHE_STALL, "CACHE STALL" }, { TRACE_HALT, "HALT" },
+    };
+
+    string text;
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+    {
+        if (status & names[i].bit)
+        {
+            if (!text.empty())
+                text += ", ";
+            text += names[i].name;
+        }
+    }
+    return text;
+}
+
+// Write one cycle in the selected format
+static void write_cycle(FILE *out, bool csv, const char *stamp, uint64_t cycle,
+                        const PipelineTraceHeader &header, const PipelineTraceRecord &r)
+{
+    bool if_valid = (r.status & TRACE_IF_VALID) != 0;
+    bool ex_valid = (r.status & TRACE_EX_VALID) != 0;
+    uint8_t if_opcode = r.opcodes >> 4;
+    uint8_t ex_opcode = r.opcodes & 0x0F;
+    string if_text = stage_text(header, if_valid, r.if_pc, if_opcode);
+    string ex_text = stage_text(header, ex_valid, r.ex_pc, ex_opcode);
+
+    if (csv)
+    {
+        fprintf(out, "%llu,%d,%d,%d,\"%s\",%d,%d,%d,\"%s\",%d,%d,%d,%d,%d\n",
+                (unsigned long long)cycle,
+                if_valid, r.if_pc, if_opcode, if_text.c_str(),
+                ex_valid, r.ex_pc, ex_opcode, ex_text.c_str(),
+                (r.status & TRACE_STALL) != 0, (r.status & TRACE_FLUSH) != 0,
+                (r.status & TRACE_FORWARD) != 0, (r.status & TRACE_CACHE_STALL) != 0,
+                (r.status & TRACE_HALT) != 0);
+        return;
+    }
+
+    string status = status_text(r.status);
+    fprintf(out, "%sCYCLE: %03llu | IF: %s | EX: %s | %s%s\n", stamp, (unsigned long long)cycle,
+            padded(if_text).c_str(), padded(ex_text).c_str(),
+            status.empty() ? "" : "STATUS: ", status.c_str());
+}
+
+int main(int argc, char* argv[])
+{
+    string in_path = "";
+    string out_path = "";
+    bool csv = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string opt = argv[i];
+        if (opt == "--csv")
+            csv = true;
+        else if (opt == "-o" && i + 1 < argc)
+            out_path = argv[++i];
+        else if (in_path.empty() && opt[0] != '-')
+            in_path = opt;
+        else
+        {
+            cerr << "Invalid option or value: " << opt << endl;
+            return 1;
+        }
+    }
+
+    if (in_path.empty())
+    {
+        cerr << "Usage: trace_decode trace.bin [--csv] [-o out]" << endl;
+        return 1;
+    }
+
+    FILE *in = fopen(in_path.c_str(), "rb");
+    if (in == nullptr)
+    {
+        cerr << "Error: Could not open " << in_path << endl;
+        return 1;
+    }
+
+    PipelineTraceHeader header;
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        memcmp(header.magic, PIPELINE_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != PIPELINE_TRACE_VERSION || header.header_size != sizeof(header))
+    {
+        cerr << "Error: " << in_path << " is not a version " << PIPELINE_TRACE_VERSION
+             << " pipeline trace" << endl;
+        fclose(in);
+        return 1;
+    }
+
+    // Trailer: total cycles
+    fseek(in, 0, SEEK_END);
+    long file_size = ftell(in);
+    uint64_t total_cycles = 0;
+    if (file_size < (long)(sizeof(header) + sizeof(total_cycles)))
+    {
+        cerr << "Error: " << in_path << " is truncated" << endl;
+        fclose(in);
+        return 1;
+    }
+    fseek(in, file_size - (long)sizeof(total_cycles), SEEK_SET);
+    if (fread(&total_cycles, sizeof(total_cycles), 1, in) != 1)
+    {
+        cerr << "Error: " << in_path << " is truncated" << endl;
+        fclose(in);
+        return 1;
+    }
+    fseek(in, sizeof(header), SEEK_SET);
+
+    FILE *out = stdout;
+    if (!out_path.empty())
+    {
+        out = fopen(out_path.c_str(), "w");
+        if (out == nullptr)
+        {
+            cerr << "Error: Could not open " << out_path << endl;
+            fclose(in);
+            return 1;
+        }
+    }
+
+    // Every line carries the trace's start time
+    char stamp[64];
+    time_t start = (time_t)header.start_time;
+    tm *ltm = localtime(&start);
+    snprintf(stamp, sizeof(stamp), "[%04d-%02d-%02d %02d:%02d:%02d] ",
+             1900 + ltm->tm_year, 1 + ltm->tm_mon, ltm->tm_mday,
+             ltm->tm_hour, ltm->tm_min, ltm->tm_sec);
+
+    if (csv)
+        fprintf(out, "cycle,if_valid,if_pc,if_opcode,if_instruction,ex_valid,ex_pc,ex_opcode,"
+                     "ex_instruction,stall,flush,forward,cache_stall,halt\n");
+
+    TraceReader *reader = new TraceReader;
+    reader->file = in;
+    reader->remaining = file_size - sizeof(header) - sizeof(total_cycles);
+    reader->pos = reader->len = 0;
+
+    // Expand records: a record holds for its own cycle, and cycles
+    // skipped before the next record repeat it
+    PipelineTraceRecord record, next;
+    uint64_t delta;
+    uint64_t cycle = 0;
+    bool have = read_record(*reader, record, delta);
+    if (have)
+        cycle = delta;
+    while (have)
+    {
+        bool more = read_record(*reader, next, delta);
+        uint64_t until = more ? cycle + delta : total_cycles + 1;
+        for (uint64_t c = cycle; c < until; c++)
+            write_cycle(out, csv, stamp, c, header, record);
+
+        record = next;
+        cycle = until;
+        have = more;
+    }
+
+    delete reader;
+    fclose(in);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
@@ -0,0 +1,20 @@
+#ifndef TRACE_POLICY_H
+#define TRACE_POLICY_H
+
+// Trace Policies
+// The per-cycle stage and cache functions are templated on one of these.
+// `enabled` is a compile-time constant, so the QuietTrace instantiations
+// contain no formatting, string building, logging or console I/O at all;
+// VerboseTrace streams to ctx.out and appends to log.txt as before.
+
+struct QuietTrace
+{
+    static const bool enabled = false;
+};
+
+struct VerboseTrace
+{
+    static const bool enabled = true;
+};
+
+#endif // TRACE_POLICY_H